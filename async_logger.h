@@ -0,0 +1,208 @@
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int LOG_LINE_MAX = 248;
+static const int LOG_RING_SIZE = 1024;  // Lines per thread, power of two
+
+struct LogRecord {
+    uint16_t length;
+    char text[LOG_LINE_MAX];
+};
+
+// Single-producer single-consumer ring owned by one logging thread and
+// drained by the logger's background thread. No locks on either side.
+struct LogRing {
+    alignas(64) std::atomic<uint64_t> head{0};  // Next slot the producer writes
+    alignas(64) std::atomic<uint64_t> tail{0};  // Next slot the consumer reads
+    std::atomic<bool> closed{false};            // Owning thread has exited
+    LogRecord records[LOG_RING_SIZE];
+
+    bool try_push(const char *text, size_t length) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == LOG_RING_SIZE) {
+            return false;
+        }
+        LogRecord& rec = records[h % LOG_RING_SIZE];
+        rec.length = (uint16_t)length;
+        std::memcpy(rec.text, text, length);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Appends everything published so far to out
+    void drain_into(std::string& out) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        for (; t != h; t++) {
+            const LogRecord& rec = records[t % LOG_RING_SIZE];
+            out.append(rec.text, rec.length);
+        }
+        tail.store(t, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+// Replaces std::cout in hot threads: each thread formats into its own ring
+// and a background thread batches everything to stdout, so logging threads
+// never share a stream lock or wait on a flush. Lines from one thread keep
+// their order; lines from different threads may interleave differently than
+// they were produced.
+class AsyncLogger {
+private:
+    std::mutex rings_lock;  // Only taken to register a thread or by the writer
+    std::vector<std::shared_ptr<LogRing>> rings;
+    std::mutex wake_lock;
+    std::condition_variable wake_cv;
+    std::condition_variable drained_cv;
+    uint64_t passes{0};
+    bool stopping{false};
+    std::thread worker;
+
+    // Registers the calling thread's ring and marks it closed on thread exit
+    struct ThreadRing {
+        std::shared_ptr<LogRing> ring;
+        ~ThreadRing() {
+            if (ring) {
+                ring->closed.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    void run() {
+        std::string batch;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> guard(rings_lock);
+                for (size_t i = 0; i < rings.size();) {
+                    rings[i]->drain_into(batch);
+                    if (rings[i]->closed.load(std::memory_order_acquire) && rings[i]->empty()) {
+                        rings[i] = rings.back();
+                        rings.pop_back();
+                    } else {
+                        i++;
+                    }
+                }
+            }
+            if (!batch.empty()) {
+                std::fwrite(batch.data(), 1, batch.size(), stdout);
+                std::fflush(stdout);
+                batch.clear();
+            }
+
+            std::unique_lock<std::mutex> guard(wake_lock);
+            passes++;
+            drained_cv.notify_all();
+            if (stopping) {
+                return;
+            }
+            wake_cv.wait_for(guard, std::chrono::milliseconds(1));
+        }
+    }
+
+public:
+    AsyncLogger() : worker(&AsyncLogger::run, this) {}
+
+    LogRing& thread_ring() {
+        thread_local ThreadRing mine;
+        if (!mine.ring) {
+            mine.ring = std::make_shared<LogRing>();
+            std::lock_guard<std::mutex> guard(rings_lock);
+            rings.push_back(mine.ring);
+        }
+        return *mine.ring;
+    }
+
+    // Never drops a line: if the ring is full the caller waits for the writer
+    void write(const char *text, size_t length) {
+        LogRing& ring = thread_ring();
+        while (!ring.try_push(text, length)) {
+            wake_cv.notify_one();
+            std::this_thread::yield();
+        }
+    }
+
+    // Returns once everything logged before the call has reached stdout
+    void flush() {
+        std::unique_lock<std::mutex> guard(wake_lock);
+        uint64_t target = passes + 2;  // The pass in progress may have missed our lines
+        wake_cv.notify_one();
+        drained_cv.wait(guard, [&]{ return passes >= target || stopping; });
+    }
+
+    ~AsyncLogger() {
+        {
+            std::lock_guard<std::mutex> guard(wake_lock);
+            stopping = true;
+        }
+        wake_cv.notify_one();
+        worker.join();
+    }
+};
+
+inline AsyncLogger& async_logger() {
+    static AsyncLogger logger;
+    return logger;
+}
+
+// Builds one line on the stack and hands it to the logger when destroyed:
+//     LogLine() << "Thread " << id << " done";
+// Lines longer than LOG_LINE_MAX are truncated.
+class LogLine {
+private:
+    char buffer[LOG_LINE_MAX];
+    size_t length{0};
+
+    void append(const char *text, size_t n) {
+        size_t room = LOG_LINE_MAX - 1 - length;  // Keep space for the newline
+        if (n > room) {
+            n = room;
+        }
+        std::memcpy(buffer + length, text, n);
+        length += n;
+    }
+
+    template <typename T>
+    LogLine& format(const char *spec, T value) {
+        char text[32];
+        int n = std::snprintf(text, sizeof(text), spec, value);
+        append(text, n > 0 ? (size_t)n : 0);
+        return *this;
+    }
+
+public:
+    LogLine() = default;
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    ~LogLine() {
+        buffer[length++] = '\n';
+        async_logger().write(buffer, length);
+    }
+
+    LogLine& operator<<(const char *text) { append(text, std::strlen(text)); return *this; }
+    LogLine& operator<<(const std::string& text) { append(text.data(), text.size()); return *this; }
+    LogLine& operator<<(char c) { append(&c, 1); return *this; }
+    LogLine& operator<<(int value) { return format("%d", value); }
+    LogLine& operator<<(unsigned value) { return format("%u", value); }
+    LogLine& operator<<(long value) { return format("%ld", value); }
+    LogLine& operator<<(unsigned long value) { return format("%lu", value); }
+    LogLine& operator<<(long long value) { return format("%lld", value); }
+    LogLine& operator<<(unsigned long long value) { return format("%llu", value); }
+    LogLine& operator<<(double value) { return format("%g", value); }
+};
+
+#endif // ASYNC_LOGGER_H
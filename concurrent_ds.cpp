@@ -4,39 +4,42 @@
 #include <atomic>
 #include <chrono>
 #include <memory>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <algorithm>
+#include "concurrent_ds.h"
+#include "async_logger.h"
+#include "metrics.h"
 
-class ApproximateConcurrentCounter {
-private:
-    // Use unique_ptr to store atomic counters to avoid copy/move issues
-    std::vector<std::unique_ptr<std::atomic<int>>> thread_counters;
-    int num_threads;
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
-public:
-    ApproximateConcurrentCounter(int threads) : num_threads(threads) {
-        thread_counters.reserve(threads); // Reserve space to avoid reallocation
-        for (int i = 0; i < threads; i++) {
-            thread_counters.push_back(std::make_unique<std::atomic<int>>(0));
+void counter_thread(ApproximateConcurrentCounter& counter, int thread_id, int target_count, bool use_handle) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    
+    if (use_handle) {
+        CounterHandle<> handle = counter.handle(thread_id);
+        for (int i = 0; i < target_count; i++) {
+            handle.increment();
         }
-    }
-
-    void increment(int thread_id) {
-        thread_counters[thread_id]->fetch_add(1, std::memory_order_relaxed);
-    }
-
-    int get_approximate_count() const {
-        int total = 0;
-        for (int i = 0; i < num_threads; i++) {
-            total += thread_counters[i]->load(std::memory_order_relaxed);
+    } else {
+        for (int i = 0; i < target_count; i++) {
+            counter.increment(thread_id);
         }
-        return total;
-    }
-
-    int get_thread_count(int thread_id) const {
-        return thread_counters[thread_id]->load(std::memory_order_relaxed);
     }
-};
+    
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    
+    LogLine() << "Thread " << thread_id << " completed counting to " 
+              << target_count << " in " << duration.count() << " ms"
+              << (use_handle ? " (handle)" : "");
+}
 
-void counter_thread(ApproximateConcurrentCounter& counter, int thread_id, int target_count) {
+void counter_thread_array(ApproximateConcurrentCounterArray& counter, int thread_id, int target_count) {
     auto start_time = std::chrono::high_resolution_clock::now();
     
     for (int i = 0; i < target_count; i++) {
@@ -46,88 +49,283 @@ void counter_thread(ApproximateConcurrentCounter& counter, int thread_id, int ta
     auto end_time = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
     
-    std::cout << "Thread " << thread_id << " completed counting to " 
-              << target_count << " in " << duration.count() << " ms" << std::endl;
+    LogLine() << "Thread " << thread_id << " completed counting to " 
+              << target_count << " in " << duration.count() << " ms (array version)";
 }
 
-// Alternative implementation using array instead of vector
-class ApproximateConcurrentCounterArray {
-private:
-    static const int MAX_THREADS = 16;
-    std::atomic<int> thread_counters[MAX_THREADS];
-    int num_threads;
-
-public:
-    ApproximateConcurrentCounterArray(int threads) : num_threads(threads) {
-        if (threads > MAX_THREADS) {
-            throw std::invalid_argument("Too many threads");
-        }
-        for (int i = 0; i < threads; i++) {
-            thread_counters[i].store(0);
-        }
+void shared_counter_thread(SharedCounter& counter, int thread_id, int target_count) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    
+    for (int i = 0; i < target_count; i++) {
+        counter.increment();
     }
+    
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    
+    LogLine() << "Thread " << thread_id << " completed counting to " 
+              << target_count << " in " << duration.count() << " ms (shared counter)";
+}
 
-    void increment(int thread_id) {
-        thread_counters[thread_id].fetch_add(1, std::memory_order_relaxed);
+// Runs fn(thread_id) on num_threads threads and returns the wall time in ms
+template <typename Fn>
+long long run_threads(int num_threads, Fn fn) {
+    std::vector<std::thread> threads;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(fn, i);
+    }
+    for (auto& t : threads) {
+        t.join();
     }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+}
 
-    int get_approximate_count() const {
-        int total = 0;
-        for (int i = 0; i < num_threads; i++) {
-            total += thread_counters[i].load(std::memory_order_relaxed);
-        }
-        return total;
+// Throughput of one counter under num_threads writers, plus the memory that
+// num_counters such counters would take
+template <typename Counter>
+void compact_counter_row(const char *name, int num_threads, int target_count, int num_counters) {
+    Counter counter(num_threads);
+    long long ms = run_threads(num_threads, [&](int id) {
+        for (int i = 0; i < target_count; i++) counter.increment(id);
+    });
+    long long count = 0;
+    if constexpr (std::is_same<Counter, ApproximateConcurrentCounter>::value) {
+        count = counter.get_approximate_count();
+    } else {
+        count = counter.get_count();
     }
+    std::cout << name << ": " << ms << " ms, count " << count << ", "
+              << counter.memory_bytes() * num_counters / 1024 << " KiB for " << num_counters
+              << " counters" << std::endl;
+}
+
+// Compile target, for labelling the memory-order matrix. x86-64 gives every
+// locked RMW full-fence semantics and only seq_cst stores cost extra, so the
+// orderings differ far less there than on ARM or POWER.
+const char *target_arch() {
+#if defined(__x86_64__)
+    return "x86-64";
+#elif defined(__aarch64__)
+    return "aarch64";
+#elif defined(__powerpc64__)
+    return "ppc64";
+#elif defined(__riscv)
+    return "riscv";
+#else
+    return "unknown";
+#endif
+}
+
+// ns per increment on per-thread and shared counters, and ns per full read of
+// a per-thread counter, under one memory-order policy
+template <typename Order>
+void memory_order_row(int num_threads, int target_count) {
+    // run_threads reports ms, too coarse for per-op costs
+    auto ns_per_op = [&](int threads, auto fn) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        run_threads(threads, fn);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count()
+            / ((double)target_count * threads);
+    };
 
-    int get_thread_count(int thread_id) const {
-        return thread_counters[thread_id].load(std::memory_order_relaxed);
+    BasicApproximateConcurrentCounter<Order> single(1);
+    double single_ns = ns_per_op(1, [&](int id) {
+        for (int i = 0; i < target_count; i++) single.increment(id);
+    });
+
+    BasicApproximateConcurrentCounter<Order> per_thread(num_threads);
+    double per_thread_ns = ns_per_op(num_threads, [&](int id) {
+        for (int i = 0; i < target_count; i++) per_thread.increment(id);
+    });
+
+    long long sum = 0;
+    double read_ns = ns_per_op(1, [&](int) {
+        for (int i = 0; i < target_count; i++) sum += per_thread.get_approximate_count();
+    });
+
+    std::cout << Order::name() << ": increment " << single_ns << " ns (1 thread), " << per_thread_ns << " ns ("
+              << num_threads << " threads); ";
+    if constexpr (!Order::single_writer) {
+        BasicSharedCounter<Order> shared;
+        double shared_ns = ns_per_op(num_threads, [&](int) {
+            for (int i = 0; i < target_count; i++) shared.increment();
+        });
+        std::cout << "shared increment " << shared_ns << " ns; ";
+    } else {
+        std::cout << "shared increment n/a; ";
     }
-};
+    std::cout << "read " << read_ns << " ns"
+              << (sum == (long long)target_count * num_threads * target_count ? "" : " (COUNT MISMATCH)")
+              << std::endl;
+}
 
-void counter_thread_array(ApproximateConcurrentCounterArray& counter, int thread_id, int target_count) {
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
-    for (int i = 0; i < target_count; i++) {
-        counter.increment(thread_id);
+// CPUs this process may run on, in id order
+std::vector<int> usable_cpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
     }
-    
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-    
-    std::cout << "Thread " << thread_id << " completed counting to " 
-              << target_count << " in " << duration.count() << " ms (array version)" << std::endl;
+#endif
+    return cpus;
 }
 
-// Shared counter for comparison
-class SharedCounter {
-private:
-    std::atomic<int> counter{0};
+bool pin_to_cpu(std::thread& t, int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0;
+#else
+    (void)t;
+    (void)cpu;
+    return false;
+#endif
+}
+
+// One-way cache line transfer time between two CPUs in ns: the line bounces
+// back and forth `rounds` times and each round trip is two transfers
+double ping_pong_ns(int cpu_a, int cpu_b, int rounds) {
+    struct alignas(64) Line {
+        std::atomic<int> value{0};
+    } line;
+    std::atomic<bool> ready{false};
+
+    std::thread pong([&] {
+        while (!ready.load(std::memory_order_acquire)) {}
+        for (int r = 0; r < rounds; r++) {
+            while (line.value.load(std::memory_order_acquire) != 2 * r + 1) {}
+            line.value.store(2 * r + 2, std::memory_order_release);
+        }
+    });
+    pin_to_cpu(pong, cpu_b);
 
-public:
-    void increment() {
-        counter.fetch_add(1, std::memory_order_relaxed);
+    double ns = 0;
+    std::thread ping([&] {
+        while (!ready.load(std::memory_order_acquire)) {}
+        auto start_time = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            line.value.store(2 * r + 1, std::memory_order_release);
+            while (line.value.load(std::memory_order_acquire) != 2 * r + 2) {}
+        }
+        auto end_time = std::chrono::steady_clock::now();
+        ns = std::chrono::duration<double, std::nano>(end_time - start_time).count() / (2.0 * rounds);
+    });
+    pin_to_cpu(ping, cpu_a);
+
+    ready.store(true, std::memory_order_release);
+    ping.join();
+    pong.join();
+    return ns;
+}
+
+// Writes an N x N CSV of one-way latencies; the diagonal is left empty
+void core_to_core_matrix(const std::string& path, int rounds) {
+    std::vector<int> cpus = usable_cpus();
+    std::cout << "\n=== Core-to-core latency (" << cpus.size() << " CPUs) ===" << std::endl;
+    if (cpus.size() < 2) {
+        std::cout << "Need at least two usable CPUs to ping-pong a cache line" << std::endl;
+        return;
     }
 
-    int get_count() const {
-        return counter.load(std::memory_order_relaxed);
+    std::ofstream out(path);
+    out << "cpu";
+    for (int cpu : cpus) {
+        out << "," << cpu;
     }
-};
+    out << "\n";
 
-void shared_counter_thread(SharedCounter& counter, int thread_id, int target_count) {
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
-    for (int i = 0; i < target_count; i++) {
-        counter.increment();
+    double lowest = 1e30, highest = 0;
+    for (int a : cpus) {
+        out << a;
+        for (int b : cpus) {
+            out << ",";
+            if (a == b) {
+                continue;
+            }
+            double ns = ping_pong_ns(a, b, rounds);
+            lowest = std::min(lowest, ns);
+            highest = std::max(highest, ns);
+            out << ns;
+        }
+        out << "\n";
     }
-    
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-    
-    std::cout << "Thread " << thread_id << " completed counting to " 
-              << target_count << " in " << duration.count() << " ms (shared counter)" << std::endl;
+
+    std::cout << "Wrote " << path << ": fastest pair " << lowest << " ns, slowest pair "
+              << highest << " ns one-way" << std::endl;
 }
 
-int main() {
+// Runs the counters with every value registered in the metrics registry and
+// a scraper exporting concurrently, then writes the final snapshot
+void export_counter_metrics(const std::string& prefix, int num_threads, int target_count) {
+    std::cout << "\n=== Metrics export ===" << std::endl;
+    MetricsRegistry& registry = metrics_registry();
+    ApproximateConcurrentCounter approx_counter(num_threads);
+    SharedCounter shared_counter;
+    AdaptiveCounter adaptive_counter(num_threads);
+
+    registry.register_callback("cds_counter_value", METRIC_GAUGE,
+        [&] { return (double)approx_counter.get_approximate_count(); },
+        {{"counter", "approximate"}}, "Current value of a benchmark counter");
+    registry.register_callback("cds_counter_value", METRIC_GAUGE,
+        [&] { return (double)shared_counter.get_count(); }, {{"counter", "shared"}});
+    registry.register_callback("cds_counter_value", METRIC_GAUGE,
+        [&] { return (double)adaptive_counter.get_count(); }, {{"counter", "adaptive"}});
+    MetricCounter& finished = registry.counter("cds_threads_finished_total", {},
+                                               "Benchmark threads that ran to completion");
+    MetricHistogram& thread_ms = registry.histogram("cds_thread_duration_ms", {1, 5, 10, 50, 100, 500},
+                                                    {}, "Wall time per benchmark thread");
+
+    std::atomic<bool> done{false};
+    int scrapes = 0;
+    std::thread scraper([&] {
+        while (!done.load(std::memory_order_relaxed)) {
+            registry.to_prometheus();
+            scrapes++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    run_threads(num_threads, [&](int id) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < target_count; i++) {
+            approx_counter.increment(id);
+            shared_counter.increment();
+            adaptive_counter.increment(id);
+        }
+        auto end_time = std::chrono::high_resolution_clock::now();
+        thread_ms.observe(std::chrono::duration<double, std::milli>(end_time - start_time).count());
+        finished.increment();
+    });
+    done.store(true, std::memory_order_relaxed);
+    scraper.join();
+
+    bool ok = MetricsRegistry::write_file(prefix + ".prom", registry.to_prometheus()) == 0
+              && MetricsRegistry::write_file(prefix + ".json", registry.to_json()) == 0;
+    std::cout << (ok ? "Wrote " : "Failed writing ") << prefix << ".prom and " << prefix << ".json ("
+              << scrapes << " scrapes while counting)" << std::endl;
+
+    // The callbacks capture locals of this function
+    registry.unregister("cds_counter_value", {{"counter", "approximate"}});
+    registry.unregister("cds_counter_value", {{"counter", "shared"}});
+    registry.unregister("cds_counter_value", {{"counter", "adaptive"}});
+}
+
+int main(int argc, char **argv) {
+    Instrument::report_at_exit();
+#ifdef FLIGHT_RECORDER
+    flight_calibrate();
+    flight_install_signal_handler("flight.bin");
+    struct DumpAtExit { ~DumpAtExit() { flight_dump("flight.bin"); } } dump_at_exit;
+#endif
     const int NUM_THREADS = 4;
     const int COUNT_TARGET = 1000000; // One million
     
@@ -144,13 +342,14 @@ int main() {
         
         // Launch threads
         for (int i = 0; i < NUM_THREADS; i++) {
-            threads.emplace_back(counter_thread, std::ref(counter), i, COUNT_TARGET);
+            threads.emplace_back(counter_thread, std::ref(counter), i, COUNT_TARGET, false);
         }
         
         // Wait for all threads to complete
         for (auto& t : threads) {
             t.join();
         }
+        async_logger().flush();
         
         auto overall_end = std::chrono::high_resolution_clock::now();
         auto overall_duration = std::chrono::duration_cast<std::chrono::milliseconds>(overall_end - overall_start);
@@ -167,6 +366,27 @@ int main() {
         }
     }
     
+    std::cout << "\n=== Approximate Counter (handle vs thread id) ===" << std::endl;
+    {
+        for (bool use_handle : {false, true}) {
+            ApproximateConcurrentCounter counter(NUM_THREADS);
+            long long ms = run_threads(NUM_THREADS, [&](int id) {
+                counter_thread(counter, id, COUNT_TARGET, use_handle);
+            });
+            async_logger().flush();
+            std::cout << (use_handle ? "Handle" : "Thread id") << " increments: " << ms
+                      << " ms, count " << counter.get_approximate_count() << std::endl;
+        }
+        // Opt-in: one writer per slot, so the handle can skip the locked add
+        BasicApproximateConcurrentCounter<SingleWriterOrder> counter(NUM_THREADS);
+        long long ms = run_threads(NUM_THREADS, [&](int id) {
+            CounterHandle<SingleWriterOrder> handle = counter.handle(id);
+            for (int i = 0; i < COUNT_TARGET; i++) handle.increment();
+        });
+        std::cout << "Single-writer handle increments: " << ms << " ms, count "
+                  << counter.get_approximate_count() << std::endl;
+    }
+    
     std::cout << "\n=== Approximate Counter (array version) ===" << std::endl;
     {
         ApproximateConcurrentCounterArray counter(NUM_THREADS);
@@ -181,6 +401,7 @@ int main() {
         for (auto& t : threads) {
             t.join();
         }
+        async_logger().flush();
         
         auto overall_end = std::chrono::high_resolution_clock::now();
         auto overall_duration = std::chrono::duration_cast<std::chrono::milliseconds>(overall_end - overall_start);
@@ -203,6 +424,7 @@ int main() {
         for (auto& t : threads) {
             t.join();
         }
+        async_logger().flush();
         
         auto end_time = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
@@ -210,6 +432,147 @@ int main() {
         std::cout << "Shared counter completed in " << duration.count() << " ms" << std::endl;
         std::cout << "Final count: " << shared_counter.get_count() << std::endl;
     }
+
+    std::cout << "\n=== Adaptive Counter across contention levels ===" << std::endl;
+    for (int contenders = 1; contenders <= 8; contenders *= 2) {
+        SharedCounter shared_counter;
+        ApproximateConcurrentCounter approx_counter(contenders);
+        AdaptiveCounter adaptive_counter(contenders);
+
+        long long shared_ms = run_threads(contenders, [&](int) {
+            for (int i = 0; i < COUNT_TARGET; i++) shared_counter.increment();
+        });
+        long long approx_ms = run_threads(contenders, [&](int id) {
+            for (int i = 0; i < COUNT_TARGET; i++) approx_counter.increment(id);
+        });
+        long long adaptive_ms = run_threads(contenders, [&](int id) {
+            for (int i = 0; i < COUNT_TARGET; i++) adaptive_counter.increment(id);
+        });
+
+        std::cout << contenders << " thread(s): shared " << shared_ms << " ms, approximate "
+                  << approx_ms << " ms, adaptive " << adaptive_ms << " ms ("
+                  << (adaptive_counter.is_inflated() ? "inflated" : "single atomic") << ", count "
+                  << adaptive_counter.get_count() << ")" << std::endl;
+    }
+    {
+        // Contention goes away: a single writer lets the counter deflate again
+        AdaptiveCounter adaptive_counter(NUM_THREADS);
+        run_threads(NUM_THREADS, [&](int id) {
+            for (int i = 0; i < COUNT_TARGET; i++) adaptive_counter.increment(id);
+        });
+        bool inflated_under_load = adaptive_counter.is_inflated();
+        adaptive_counter.maybe_deflate();
+        run_threads(1, [&](int id) {
+            for (int i = 0; i < COUNT_TARGET; i++) adaptive_counter.increment(id);
+        });
+        adaptive_counter.maybe_deflate();
+        std::cout << "Under load: " << (inflated_under_load ? "inflated" : "single atomic")
+                  << ", after going idle: " << (adaptive_counter.is_inflated() ? "inflated" : "single atomic")
+                  << ", count " << adaptive_counter.get_count()
+                  << " (expected " << (NUM_THREADS + 1) * COUNT_TARGET << ")" << std::endl;
+    }
+
+    std::cout << "\n=== Block-leased ID generator vs single atomic ===" << std::endl;
+    {
+        const int TOTAL_IDS = 4000000;
+        for (int num_threads = 1; num_threads <= 128; num_threads *= 2) {
+            int per_thread = TOTAL_IDS / num_threads;
+            BlockIdGenerator single(num_threads, 1, true);
+            BlockIdGenerator leased(num_threads);
+            std::vector<std::vector<int64_t>> issued(num_threads);
+
+            long long single_ms = run_threads(num_threads, [&](int id) {
+                for (int i = 0; i < per_thread; i++) single.next(id);
+            });
+            long long leased_ms = run_threads(num_threads, [&](int id) {
+                std::vector<int64_t>& mine = issued[id];
+                mine.reserve(per_thread);
+                for (int i = 0; i < per_thread; i++) mine.push_back(leased.next(id));
+            });
+
+            std::vector<int64_t> all;
+            all.reserve((size_t)per_thread * num_threads);
+            for (auto& ids : issued) {
+                all.insert(all.end(), ids.begin(), ids.end());
+            }
+            std::sort(all.begin(), all.end());
+            bool unique = std::adjacent_find(all.begin(), all.end()) == all.end();
+
+            std::cout << num_threads << " thread(s): single atomic " << single_ms << " ms, leased "
+                      << leased_ms << " ms" << (unique ? "" : " (DUPLICATE IDS)") << std::endl;
+        }
+    }
+
+    std::cout << "\n=== Compact Counters (narrow slots folded into 64 bits) ===" << std::endl;
+    {
+        const int COMPACT_THREADS = 256;
+        const int NUM_COUNTERS = 1000;
+        int per_thread = 100000;  // Past the 16-bit range, so those slots fold
+        std::cout << COMPACT_THREADS << " threads, each counting to " << per_thread << std::endl;
+        compact_counter_row<CompactCounter16>("16-bit slots", COMPACT_THREADS, per_thread, NUM_COUNTERS);
+        compact_counter_row<CompactCounter32>("32-bit slots", COMPACT_THREADS, per_thread, NUM_COUNTERS);
+        compact_counter_row<CompactConcurrentCounter<uint64_t>>("64-bit slots", COMPACT_THREADS, per_thread,
+                                                                NUM_COUNTERS);
+        compact_counter_row<ApproximateConcurrentCounter>("Padded slots", COMPACT_THREADS, per_thread,
+                                                          NUM_COUNTERS);
+    }
+
+    std::cout << "\n=== Per-CPU Counter (10x oversubscribed) ===" << std::endl;
+    {
+        unsigned cpus = std::thread::hardware_concurrency();
+        int oversubscribed = 10 * (cpus ? cpus : 1);
+        int per_thread = COUNT_TARGET / 10;
+        PerCpuCounter percpu_counter;
+        PerCpuCounter fallback_counter;
+        ApproximateConcurrentCounter approx_counter(oversubscribed);
+
+        long long rseq_ms = run_threads(oversubscribed, [&](int) {
+            for (int i = 0; i < per_thread; i++) percpu_counter.increment();
+        });
+        long long fallback_ms = run_threads(oversubscribed, [&](int) {
+            for (int i = 0; i < per_thread; i++) fallback_counter.increment_atomic();
+        });
+        long long approx_ms = run_threads(oversubscribed, [&](int id) {
+            for (int i = 0; i < per_thread; i++) approx_counter.increment(id);
+        });
+
+        std::cout << oversubscribed << " threads on " << cpus << " CPUs, each counting to " << per_thread << std::endl;
+        std::cout << "Per-CPU (" << (PerCpuCounter::uses_rseq() ? "rseq" : "no rseq, atomic") << "): "
+                  << rseq_ms << " ms, count " << percpu_counter.get_count() << ", "
+                  << percpu_counter.get_num_slots() << " slots" << std::endl;
+        std::cout << "Per-CPU (sched_getcpu + atomic): " << fallback_ms << " ms, count "
+                  << fallback_counter.get_count() << std::endl;
+        std::cout << "Per-thread approximate: " << approx_ms << " ms, count "
+                  << approx_counter.get_approximate_count() << ", " << oversubscribed << " slots" << std::endl;
+    }
+
+    std::cout << "\n=== Counter memory orders (" << target_arch() << ") ===" << std::endl;
+    {
+        memory_order_row<RelaxedOrder>(NUM_THREADS, COUNT_TARGET);
+        memory_order_row<ReleaseAcquireOrder>(NUM_THREADS, COUNT_TARGET);
+        memory_order_row<SeqCstOrder>(NUM_THREADS, COUNT_TARGET);
+        memory_order_row<SingleWriterOrder>(NUM_THREADS, COUNT_TARGET);
+    }
+
+    // --latency-matrix [out.csv]: also map cache line transfer costs
+    // --metrics <prefix>: export counters to <prefix>.prom and <prefix>.json
+    std::string latency_path, metrics_prefix;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc && argv[i + 1][0] != '-';
+        if (arg == "--latency-matrix") {
+            latency_path = has_value ? argv[++i] : "core_latency.csv";
+        } else if (arg == "--metrics") {
+            metrics_prefix = has_value ? argv[++i] : "counters";
+        }
+    }
+
+    if (!latency_path.empty()) {
+        core_to_core_matrix(latency_path, 100000);
+    }
+    if (!metrics_prefix.empty()) {
+        export_counter_metrics(metrics_prefix, NUM_THREADS, COUNT_TARGET);
+    }
     
     return 0;
 }
@@ -0,0 +1,550 @@
+#ifndef CONCURRENT_DS_H
+#define CONCURRENT_DS_H
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <cstdint>
+#include <limits>
+#include <unistd.h>
+#include "flight_recorder.h"
+#include "instrument.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+// Restartable sequences need glibc 2.35+ (which registers the rseq area for
+// every thread) and hand-written asm, so they are only used on x86-64 Linux
+#if defined(__linux__) && defined(__x86_64__) && defined(__has_include)
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define CDS_HAVE_RSEQ 1
+#endif
+#endif
+
+// Memory-ordering policies for the counters below. Relaxed is the default
+// and is enough for statistics. ReleaseAcquire makes every write a thread
+// did before an increment visible to a reader whose load sees that
+// increment. SeqCst adds one total order over all counter operations.
+// SingleWriter swaps the locked RMW for a relaxed load + store, which is only
+// correct while each slot has exactly one writer.
+struct RelaxedOrder {
+    static constexpr std::memory_order rmw = std::memory_order_relaxed;
+    static constexpr std::memory_order load = std::memory_order_relaxed;
+    static constexpr bool single_writer = false;
+    static const char *name() { return "relaxed"; }
+};
+
+struct ReleaseAcquireOrder {
+    static constexpr std::memory_order rmw = std::memory_order_release;
+    static constexpr std::memory_order load = std::memory_order_acquire;
+    static constexpr bool single_writer = false;
+    static const char *name() { return "release/acquire"; }
+};
+
+struct SeqCstOrder {
+    static constexpr std::memory_order rmw = std::memory_order_seq_cst;
+    static constexpr std::memory_order load = std::memory_order_seq_cst;
+    static constexpr bool single_writer = false;
+    static const char *name() { return "seq_cst"; }
+};
+
+struct SingleWriterOrder {
+    static constexpr std::memory_order rmw = std::memory_order_relaxed;
+    static constexpr std::memory_order load = std::memory_order_relaxed;
+    static constexpr bool single_writer = true;
+    static const char *name() { return "single-writer"; }
+};
+
+template <typename Order, typename T>
+inline T ordered_add(std::atomic<T>& target, T n) {
+    if (Order::single_writer) {
+        T old = target.load(std::memory_order_relaxed);
+        target.store(old + n, Order::rmw);
+        return old;
+    }
+    return target.fetch_add(n, Order::rmw);
+}
+
+// Caches a pointer to one thread's slot, so an increment skips the index
+// lookup: loading the slot array and scaling thread_id to its slot (neither
+// path bounds-checks the id). It uses the counter's ordering
+// policy, like increment(thread_id); only a SingleWriterOrder counter's
+// handles drop the locked add, and then each slot needs exactly one writer.
+template <typename Order = RelaxedOrder>
+class CounterHandle {
+private:
+    std::atomic<int> *slot;
+
+public:
+    explicit CounterHandle(std::atomic<int> *s) : slot(s) {}
+
+    void increment() {
+        ordered_add<Order>(*slot, 1);
+        FR_RECORD(FR_COUNTER_INCREMENT, 0, 0, 0);
+        CDS_COUNT(EV_COUNTER_INCREMENT);
+    }
+
+    void add(int n) {
+        ordered_add<Order>(*slot, n);
+    }
+};
+
+template <typename Order = RelaxedOrder>
+class BasicApproximateConcurrentCounter {
+private:
+    // One cache line per thread so neighbouring writers don't false-share
+    struct alignas(64) Slot {
+        std::atomic<int> value{0};
+    };
+
+    std::unique_ptr<Slot[]> thread_counters;
+    int num_threads;
+
+public:
+    BasicApproximateConcurrentCounter(int threads) : thread_counters(new Slot[threads]), num_threads(threads) {}
+
+    void increment(int thread_id) {
+        ordered_add<Order>(thread_counters[thread_id].value, 1);
+        FR_RECORD(FR_COUNTER_INCREMENT, thread_id, 0, 0);
+        CDS_COUNT(EV_COUNTER_INCREMENT);
+    }
+
+    // Obtain once per thread and increment through it in hot loops
+    CounterHandle<Order> handle(int thread_id) {
+        return CounterHandle<Order>(&thread_counters[thread_id].value);
+    }
+
+    int get_approximate_count() const {
+        int total = 0;
+        for (int i = 0; i < num_threads; i++) {
+            total += thread_counters[i].value.load(Order::load);
+        }
+        return total;
+    }
+
+    int get_thread_count(int thread_id) const {
+        return thread_counters[thread_id].value.load(Order::load);
+    }
+
+    size_t memory_bytes() const {
+        return sizeof(*this) + num_threads * sizeof(Slot);
+    }
+};
+
+typedef BasicApproximateConcurrentCounter<> ApproximateConcurrentCounter;
+
+// Memory-lean variant for many counters: narrow unpadded per-thread slots
+// that fold into a shared 64-bit total before they can overflow, so totals
+// stay exact at any count. Slots of different threads share cache lines,
+// trading some false sharing for 2-4 bytes per thread instead of a line.
+template <typename SlotType, typename Order = RelaxedOrder>
+class CompactConcurrentCounter {
+private:
+    static const SlotType FOLD_AT = std::numeric_limits<SlotType>::max() / 2;
+    // A fold must publish its add to global before the slot drops, whatever
+    // the policy
+    static constexpr std::memory_order FOLD_ORDER =
+        Order::rmw == std::memory_order_seq_cst ? std::memory_order_seq_cst : std::memory_order_release;
+    static constexpr std::memory_order READ_ORDER =
+        Order::load == std::memory_order_seq_cst ? std::memory_order_seq_cst : std::memory_order_acquire;
+
+    std::atomic<int64_t> global{0};
+    std::unique_ptr<std::atomic<SlotType>[]> slots;
+    int num_threads;
+
+public:
+    CompactConcurrentCounter(int threads) : slots(new std::atomic<SlotType>[threads]), num_threads(threads) {
+        for (int i = 0; i < threads; i++) {
+            slots[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void increment(int thread_id) {
+        std::atomic<SlotType>& slot = slots[thread_id];
+        if (ordered_add<Order>(slot, (SlotType)1) >= FOLD_AT) {
+            // Rare: move the slot into the global before it wraps. Every
+            // thread folds into global, so this stays an RMW under any policy.
+            // The amount is added to global before it leaves the slot, so a
+            // read never misses it (at worst counts it twice, briefly).
+            SlotType amount = slot.load(std::memory_order_relaxed);
+            global.fetch_add(amount, Order::rmw);
+            slot.fetch_sub(amount, FOLD_ORDER);
+        }
+    }
+
+    // Exact once writers are quiescent. Slots are read before global, with
+    // acquire, so a slot already emptied by a fold implies its amount is
+    // visible in global.
+    int64_t get_count() const {
+        int64_t total = 0;
+        for (int i = 0; i < num_threads; i++) {
+            total += slots[i].load(READ_ORDER);
+        }
+        return total + global.load(READ_ORDER);
+    }
+
+    size_t memory_bytes() const {
+        return sizeof(*this) + num_threads * sizeof(std::atomic<SlotType>);
+    }
+};
+
+typedef CompactConcurrentCounter<uint16_t> CompactCounter16;
+typedef CompactConcurrentCounter<uint32_t> CompactCounter32;
+
+// Alternative implementation using array instead of vector
+template <typename Order = RelaxedOrder>
+class BasicApproximateConcurrentCounterArray {
+private:
+    static const int MAX_THREADS = 16;
+    std::atomic<int> thread_counters[MAX_THREADS];
+    int num_threads;
+
+public:
+    BasicApproximateConcurrentCounterArray(int threads) : num_threads(threads) {
+        if (threads > MAX_THREADS) {
+            throw std::invalid_argument("Too many threads");
+        }
+        for (int i = 0; i < threads; i++) {
+            thread_counters[i].store(0);
+        }
+    }
+
+    void increment(int thread_id) {
+        ordered_add<Order>(thread_counters[thread_id], 1);
+    }
+
+    int get_approximate_count() const {
+        int total = 0;
+        for (int i = 0; i < num_threads; i++) {
+            total += thread_counters[i].load(Order::load);
+        }
+        return total;
+    }
+
+    int get_thread_count(int thread_id) const {
+        return thread_counters[thread_id].load(Order::load);
+    }
+};
+
+typedef BasicApproximateConcurrentCounterArray<> ApproximateConcurrentCounterArray;
+
+// Shared counter for comparison
+template <typename Order = RelaxedOrder>
+class BasicSharedCounter {
+private:
+    static_assert(!Order::single_writer, "SharedCounter is written by every thread");
+
+    std::atomic<int> counter{0};
+
+public:
+    void increment() {
+        ordered_add<Order>(counter, 1);
+        FR_RECORD(FR_SHARED_INCREMENT, 0, 0, 0);
+        CDS_COUNT(EV_SHARED_INCREMENT);
+    }
+
+    int get_count() const {
+        return counter.load(Order::load);
+    }
+};
+
+typedef BasicSharedCounter<> SharedCounter;
+
+// Hands out unique IDs without touching a shared cache line per call: each
+// thread leases a block of block_size IDs with one fetch_add on the global
+// counter and serves them from its own padded slot. IDs increase within a
+// thread but interleave across threads, and IDs left in a thread's block
+// when it stops are never issued. Strict mode gives every ID straight from
+// the global counter (one fetch_add each, like SharedCounter) for callers
+// that need IDs ordered across threads.
+class BlockIdGenerator {
+private:
+    struct alignas(64) Lease {
+        int64_t next{0};
+        int64_t end{0};
+    };
+
+    alignas(64) std::atomic<int64_t> global{0};
+    std::unique_ptr<Lease[]> leases;
+    int num_threads;
+    int64_t block_size;
+    bool strict;
+
+public:
+    BlockIdGenerator(int threads, int64_t block = 1024, bool strict_order = false)
+        : leases(new Lease[threads]), num_threads(threads), block_size(block), strict(strict_order) {
+        if (block <= 0) {
+            throw std::invalid_argument("Block size must be positive");
+        }
+    }
+
+    int64_t next(int thread_id) {
+        if (strict) {
+            return global.fetch_add(1, std::memory_order_relaxed);
+        }
+        Lease& lease = leases[thread_id];
+        if (lease.next == lease.end) {
+            lease.next = global.fetch_add(block_size, std::memory_order_relaxed);
+            lease.end = lease.next + block_size;
+        }
+        return lease.next++;
+    }
+
+    // Every ID issued so far is below this
+    int64_t upper_bound() const {
+        return global.load(std::memory_order_relaxed);
+    }
+
+    bool is_strict() const {
+        return strict;
+    }
+};
+
+// Starts out as a single atomic like SharedCounter and inflates to padded
+// per-thread slots once it is contended. While deflated an increment is the
+// same plain fetch_add as SharedCounter; one increment in SAMPLE_EVERY also
+// probes the line with a no-op CAS, and enough failed probes within one
+// window of PROBE_WINDOW probes inflate it. Failures from older windows are
+// forgotten, so sporadic contention over a long lifetime never adds up.
+// Reads are exact while deflated; once inflated they sum the slots like
+// ApproximateConcurrentCounter.
+class AdaptiveCounter {
+private:
+    struct alignas(64) Slot {
+        std::atomic<int> value{0};
+        std::atomic<bool> touched{false};
+    };
+
+    static const int SAMPLE_EVERY = 64;       // Increments per contention probe, a power of two
+    static const int PROBE_WINDOW = 32;       // Probes per window
+    static const int INFLATE_THRESHOLD = 8;   // Failed probes in one window before inflating
+
+    alignas(64) std::atomic<int> base{0};
+    // Failed probes and probes so far in the current window
+    alignas(64) std::atomic<int> contention{0};
+    std::atomic<int> probes{0};
+    // Read on every increment, written only on inflate/deflate
+    alignas(64) std::atomic<bool> inflated{false};
+    std::atomic<Slot*> slots{nullptr};
+    std::unique_ptr<Slot[]> slot_storage;  // Kept once allocated so late writers stay safe
+    std::mutex resize_lock;
+    int num_threads;
+
+    void inflate() {
+        std::lock_guard<std::mutex> guard(resize_lock);
+        if (!slot_storage) {
+            slot_storage.reset(new Slot[num_threads]);
+            slots.store(slot_storage.get(), std::memory_order_release);
+        }
+        inflated.store(true, std::memory_order_release);
+        FR_RECORD(FR_ADAPTIVE_INFLATE, 0, 0, 0);
+    }
+
+    // A CAS that writes back the value just read fails only if another
+    // thread wrote the line in between
+    void probe() {
+        int seen = base.load(std::memory_order_relaxed);
+        int failures = base.compare_exchange_strong(seen, seen, std::memory_order_relaxed)
+            ? contention.load(std::memory_order_relaxed)
+            : contention.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (failures >= INFLATE_THRESHOLD) {
+            inflate();
+        }
+        if (probes.fetch_add(1, std::memory_order_relaxed) + 1 >= PROBE_WINDOW) {
+            // Racing resets only shorten a window, which errs towards staying deflated
+            probes.store(0, std::memory_order_relaxed);
+            contention.store(0, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    AdaptiveCounter(int threads) : num_threads(threads) {}
+
+    void increment(int thread_id) {
+        if (!inflated.load(std::memory_order_relaxed)) {
+            if ((base.fetch_add(1, std::memory_order_relaxed) & (SAMPLE_EVERY - 1)) == 0) {
+                probe();
+            }
+            return;
+        }
+        Slot& slot = slots.load(std::memory_order_acquire)[thread_id];
+        slot.value.fetch_add(1, std::memory_order_relaxed);
+        if (!slot.touched.load(std::memory_order_relaxed)) {
+            slot.touched.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    int get_count() const {
+        // Slots before base, with acquire, so a slot already emptied by a
+        // deflate implies its amount is visible in base
+        int total = 0;
+        Slot *current = slots.load(std::memory_order_acquire);
+        if (current != nullptr) {
+            for (int i = 0; i < num_threads; i++) {
+                total += current[i].value.load(std::memory_order_acquire);
+            }
+        }
+        return total + base.load(std::memory_order_relaxed);
+    }
+
+    // Call periodically from a reader or maintenance thread. If at most one
+    // thread has incremented since the last call, folds the slots back into
+    // the single atomic. Increments racing with the fold land in a slot and
+    // are still counted by get_count().
+    bool maybe_deflate() {
+        std::lock_guard<std::mutex> guard(resize_lock);
+        if (!inflated.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        Slot *current = slots.load(std::memory_order_relaxed);
+        int active = 0;
+        for (int i = 0; i < num_threads; i++) {
+            active += current[i].touched.exchange(false, std::memory_order_relaxed);
+        }
+        if (active > 1) {
+            return false;
+        }
+        inflated.store(false, std::memory_order_relaxed);
+        contention.store(0, std::memory_order_relaxed);
+        probes.store(0, std::memory_order_relaxed);
+        // Into base before out of the slot, so get_count() never misses it
+        for (int i = 0; i < num_threads; i++) {
+            int amount = current[i].value.load(std::memory_order_relaxed);
+            base.fetch_add(amount, std::memory_order_relaxed);
+            current[i].value.fetch_sub(amount, std::memory_order_release);
+        }
+        FR_RECORD(FR_ADAPTIVE_DEFLATE, active, 0, 0);
+        return true;
+    }
+
+    bool is_inflated() const {
+        return inflated.load(std::memory_order_relaxed);
+    }
+};
+
+#ifdef CDS_HAVE_RSEQ
+static_assert(RSEQ_SIG == 0x53053053, "rseq abort signature below assumes the x86 RSEQ_SIG");
+
+inline struct rseq *rseq_area() {
+    return reinterpret_cast<struct rseq *>(static_cast<char *>(__builtin_thread_pointer()) + __rseq_offset);
+}
+
+inline bool rseq_registered() {
+    return __rseq_size > 0 && (int32_t)__atomic_load_n(&rseq_area()->cpu_id, __ATOMIC_RELAXED) >= 0;
+}
+
+// Adds count to *target only if the thread is still on `cpu` and is not
+// preempted before the add. Returns false if the kernel aborted the sequence.
+inline bool rseq_add_on_cpu(std::atomic<int> *target, int count, uint32_t cpu) {
+    struct rseq *rs = rseq_area();
+    __asm__ __volatile__ goto(
+        ".pushsection __rseq_cs, \"aw\"\n\t"
+        ".balign 32\n\t"
+        "3:\n\t"
+        ".long 0, 0\n\t"                      // version, flags
+        ".quad 1f, (2f - 1f), 4f\n\t"         // start, length, abort
+        ".popsection\n\t"
+        "leaq 3b(%%rip), %%rax\n\t"
+        "movq %%rax, %[rseq_cs]\n\t"
+        "1:\n\t"
+        "cmpl %[cpu], %[cpu_id]\n\t"
+        "jnz 4f\n\t"
+        "addl %[count], %[target]\n\t"        // Commit: plain add, no lock prefix
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        ".byte 0x0f, 0xb9, 0x3d\n\t"
+        ".long 0x53053053\n\t"
+        "4:\n\t"
+        "jmp %l[aborted]\n\t"
+        ".popsection\n\t"
+        :
+        : [cpu] "r"(cpu), [cpu_id] "m"(rs->cpu_id), [rseq_cs] "m"(rs->rseq_cs),
+          [target] "m"(*target), [count] "ir"(count)
+        : "memory", "cc", "rax"
+        : aborted);
+    return true;
+aborted:
+    return false;
+}
+#endif
+
+// One padded slot per CPU instead of per thread, so memory stays fixed no
+// matter how many threads increment. With rseq the add is a plain,
+// non-atomic instruction that the kernel restarts if the thread migrates;
+// otherwise it falls back to sched_getcpu() and an atomic add on that slot.
+class PerCpuCounter {
+private:
+    struct alignas(64) Slot {
+        std::atomic<int> value{0};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    int num_cpus;
+
+    int current_cpu() const {
+#if defined(__linux__)
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && cpu < num_cpus) {
+            return cpu;
+        }
+#endif
+        return (int)(std::hash<std::thread::id>()(std::this_thread::get_id()) % num_cpus);
+    }
+
+public:
+    PerCpuCounter() {
+        long cpus = sysconf(_SC_NPROCESSORS_CONF);
+        num_cpus = cpus > 0 ? (int)cpus : 1;
+        slots.reset(new Slot[num_cpus]);
+    }
+
+    void increment() {
+#ifdef CDS_HAVE_RSEQ
+        if (rseq_registered()) {
+            while (true) {
+                uint32_t cpu = __atomic_load_n(&rseq_area()->cpu_id, __ATOMIC_RELAXED);
+                if (cpu >= (uint32_t)num_cpus) {
+                    break;
+                }
+                if (rseq_add_on_cpu(&slots[cpu].value, 1, cpu)) {
+                    return;
+                }
+            }
+        }
+#endif
+        increment_atomic();
+    }
+
+    // The portable path, also useful for comparing against rseq
+    void increment_atomic() {
+        slots[current_cpu()].value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int get_count() const {
+        int total = 0;
+        for (int i = 0; i < num_cpus; i++) {
+            total += slots[i].value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    int get_num_slots() const {
+        return num_cpus;
+    }
+
+    static bool uses_rseq() {
+#ifdef CDS_HAVE_RSEQ
+        return rseq_registered();
+#else
+        return false;
+#endif
+    }
+};
+
+#endif // CONCURRENT_DS_H
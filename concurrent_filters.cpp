@@ -0,0 +1,157 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <memory>
+#include "concurrent_filters.h"
+
+// Keys [0, n) are inserted; keys with the top bit set are never inserted
+static uint64_t present_key(uint64_t i) { return i * 0x9e3779b97f4a7c15ULL >> 1; }
+static uint64_t absent_key(uint64_t i) { return present_key(i) | (1ULL << 63); }
+
+template <typename Fn>
+long long timed_threads(int num_threads, Fn fn) {
+    std::vector<std::thread> threads;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(fn, i);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+}
+
+void report(const char *what, long long ms, uint64_t ops) {
+    std::cout << what << ": " << ms << " ms ("
+              << (ms > 0 ? ops / 1000 / ms : 0) << " Mops/s)" << std::endl;
+}
+
+int main() {
+    const int NUM_THREADS = 4;
+    const uint64_t NUM_KEYS = 4000000;
+    const uint64_t PER_THREAD = NUM_KEYS / NUM_THREADS;
+
+    std::cout << "=== Blocked Bloom filter ===" << std::endl;
+    {
+        BlockedBloomFilter filter(NUM_KEYS);
+        std::cout << "Memory: " << filter.memory_bytes() / 1024 << " KiB" << std::endl;
+
+        long long ms = timed_threads(NUM_THREADS, [&](int t) {
+            for (uint64_t i = t * PER_THREAD; i < (t + 1) * PER_THREAD; i++) {
+                filter.insert(present_key(i));
+            }
+        });
+        report("Insert", ms, NUM_KEYS);
+
+        std::vector<uint64_t> false_positives(NUM_THREADS, 0);
+        ms = timed_threads(NUM_THREADS, [&](int t) {
+            for (uint64_t i = t * PER_THREAD; i < (t + 1) * PER_THREAD; i++) {
+                false_positives[t] += filter.contains(absent_key(i));
+            }
+        });
+        report("Lookup (absent keys)", ms, NUM_KEYS);
+
+        // Same lookups through the batched path
+        std::vector<uint64_t> batch_hits(NUM_THREADS, 0);
+        ms = timed_threads(NUM_THREADS, [&](int t) {
+            const size_t CHUNK = 1024;
+            std::vector<uint64_t> keys(CHUNK);
+            std::unique_ptr<bool[]> results(new bool[CHUNK]);
+            for (uint64_t i = t * PER_THREAD; i < (t + 1) * PER_THREAD; i += CHUNK) {
+                size_t len = std::min<uint64_t>(CHUNK, (t + 1) * PER_THREAD - i);
+                for (size_t j = 0; j < len; j++) {
+                    keys[j] = present_key(i + j);
+                }
+                filter.contains_batch(keys.data(), results.get(), len);
+                for (size_t j = 0; j < len; j++) {
+                    batch_hits[t] += results[j];
+                }
+            }
+        });
+        report("Batched lookup (present keys)", ms, NUM_KEYS);
+
+        uint64_t fp = 0, hits = 0;
+        for (int t = 0; t < NUM_THREADS; t++) {
+            fp += false_positives[t];
+            hits += batch_hits[t];
+        }
+        std::cout << "False positive rate: " << 100.0 * fp / NUM_KEYS << "%" << std::endl;
+        std::cout << "Present keys found: " << hits << " / " << NUM_KEYS << std::endl;
+    }
+
+    std::cout << "\n=== Cuckoo filter ===" << std::endl;
+    {
+        CuckooFilter filter(NUM_KEYS);
+        std::cout << "Memory: " << filter.memory_bytes() / 1024 << " KiB" << std::endl;
+
+        std::vector<uint64_t> failed(NUM_THREADS, 0);
+        long long ms = timed_threads(NUM_THREADS, [&](int t) {
+            for (uint64_t i = t * PER_THREAD; i < (t + 1) * PER_THREAD; i++) {
+                failed[t] += !filter.insert(present_key(i));
+            }
+        });
+        report("Insert", ms, NUM_KEYS);
+        std::cout << "Load factor: " << 100.0 * filter.load_factor() << "%" << std::endl;
+
+        std::vector<uint64_t> false_positives(NUM_THREADS, 0);
+        ms = timed_threads(NUM_THREADS, [&](int t) {
+            for (uint64_t i = t * PER_THREAD; i < (t + 1) * PER_THREAD; i++) {
+                false_positives[t] += filter.contains(absent_key(i));
+            }
+        });
+        report("Lookup (absent keys)", ms, NUM_KEYS);
+
+        // Half the keys are erased while the other half are being looked up
+        std::vector<uint64_t> misses(NUM_THREADS, 0);
+        ms = timed_threads(NUM_THREADS, [&](int t) {
+            for (uint64_t i = t * PER_THREAD; i < (t + 1) * PER_THREAD; i++) {
+                if (i % 2) {
+                    filter.erase(present_key(i));
+                } else {
+                    misses[t] += !filter.contains(present_key(i));
+                }
+            }
+        });
+        report("Mixed erase/lookup", ms, NUM_KEYS);
+
+        uint64_t fp = 0, fails = 0, missed = 0;
+        for (int t = 0; t < NUM_THREADS; t++) {
+            fp += false_positives[t];
+            fails += failed[t];
+            missed += misses[t];
+        }
+        std::cout << "Failed inserts: " << fails << std::endl;
+        std::cout << "False positive rate: " << 100.0 * fp / NUM_KEYS << "%" << std::endl;
+        std::cout << "Live keys missed during erases: " << missed << std::endl;
+        std::cout << "Items after erase: " << filter.size() << std::endl;
+    }
+
+    // A power-of-two key count leaves no rounding slack, so this is the
+    // fullest table the sizing rule produces
+    std::cout << "\n=== Cuckoo filter (power-of-two key count) ===" << std::endl;
+    {
+        const uint64_t POW2_KEYS = 1 << 22;
+        const uint64_t POW2_PER_THREAD = POW2_KEYS / NUM_THREADS;
+        CuckooFilter filter(POW2_KEYS);
+        std::cout << "Memory: " << filter.memory_bytes() / 1024 << " KiB" << std::endl;
+
+        std::vector<uint64_t> failed(NUM_THREADS, 0);
+        long long ms = timed_threads(NUM_THREADS, [&](int t) {
+            for (uint64_t i = t * POW2_PER_THREAD; i < (t + 1) * POW2_PER_THREAD; i++) {
+                failed[t] += !filter.insert(present_key(i));
+            }
+        });
+        report("Insert", ms, POW2_KEYS);
+        uint64_t fails = 0;
+        for (uint64_t f : failed) {
+            fails += f;
+        }
+        std::cout << "Load factor: " << 100.0 * filter.load_factor() << "%" << std::endl;
+        std::cout << "Failed inserts: " << fails << std::endl;
+    }
+
+    return 0;
+}
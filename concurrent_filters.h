@@ -0,0 +1,339 @@
+#ifndef CONCURRENT_FILTERS_H
+#define CONCURRENT_FILTERS_H
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <cstdint>
+#include <cstddef>
+
+// Branch-free 64-bit mixer (murmur3 finalizer). Only shifts, xors and
+// multiplies, so loops over arrays of keys auto-vectorize.
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+inline void hash_batch(const uint64_t *keys, uint64_t *hashes, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        hashes[i] = mix64(keys[i]);
+    }
+}
+
+inline size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// Bloom filter where all k bits of a key land in one 64-byte block, so an
+// insert or lookup touches a single cache line. Inserts are atomic fetch_or,
+// so any number of threads can insert and query concurrently.
+class BlockedBloomFilter {
+private:
+    static const int BLOCK_BITS = 512;
+    static const size_t BATCH = 64;
+
+    struct alignas(64) Block {
+        std::atomic<uint64_t> words[BLOCK_BITS / 64];
+    };
+
+    std::unique_ptr<Block[]> blocks;
+    size_t block_mask;
+    int num_hashes;
+
+    Block& block_for(uint64_t hash) const {
+        return blocks[hash & block_mask];
+    }
+
+    // Double hashing inside the block: bit i = h1 + i * h2 (mod 512)
+    void set_bits(uint64_t hash) {
+        Block& block = block_for(hash);
+        uint32_t h1 = (uint32_t)(hash >> 32);
+        uint32_t h2 = (uint32_t)(hash >> 16) | 1;
+        for (int i = 0; i < num_hashes; i++) {
+            uint32_t bit = (h1 + i * h2) % BLOCK_BITS;
+            block.words[bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_relaxed);
+        }
+    }
+
+    bool test_bits(uint64_t hash) const {
+        const Block& block = block_for(hash);
+        uint32_t h1 = (uint32_t)(hash >> 32);
+        uint32_t h2 = (uint32_t)(hash >> 16) | 1;
+        bool present = true;
+        for (int i = 0; i < num_hashes; i++) {
+            uint32_t bit = (h1 + i * h2) % BLOCK_BITS;
+            present &= (block.words[bit / 64].load(std::memory_order_relaxed) >> (bit % 64)) & 1;
+        }
+        return present;
+    }
+
+public:
+    // bits_per_key around 10 with 7 hashes gives roughly a 1% false positive rate
+    BlockedBloomFilter(size_t expected_keys, int bits_per_key = 10, int hashes = 7)
+        : num_hashes(hashes) {
+        size_t num_blocks = round_up_pow2((expected_keys * bits_per_key + BLOCK_BITS - 1) / BLOCK_BITS);
+        blocks.reset(new Block[num_blocks]);
+        block_mask = num_blocks - 1;
+        for (size_t b = 0; b < num_blocks; b++) {
+            for (auto& word : blocks[b].words) {
+                word.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void insert(uint64_t key) {
+        set_bits(mix64(key));
+    }
+
+    bool contains(uint64_t key) const {
+        return test_bits(mix64(key));
+    }
+
+    // Hashes a chunk of keys in one vectorizable pass, then touches the blocks
+    void insert_batch(const uint64_t *keys, size_t n) {
+        uint64_t hashes[BATCH];
+        for (size_t base = 0; base < n; base += BATCH) {
+            size_t len = n - base < BATCH ? n - base : BATCH;
+            hash_batch(keys + base, hashes, len);
+            for (size_t i = 0; i < len; i++) {
+                __builtin_prefetch(&block_for(hashes[i]), 1);
+            }
+            for (size_t i = 0; i < len; i++) {
+                set_bits(hashes[i]);
+            }
+        }
+    }
+
+    void contains_batch(const uint64_t *keys, bool *results, size_t n) const {
+        uint64_t hashes[BATCH];
+        for (size_t base = 0; base < n; base += BATCH) {
+            size_t len = n - base < BATCH ? n - base : BATCH;
+            hash_batch(keys + base, hashes, len);
+            for (size_t i = 0; i < len; i++) {
+                __builtin_prefetch(&block_for(hashes[i]), 0);
+            }
+            for (size_t i = 0; i < len; i++) {
+                results[base + i] = test_bits(hashes[i]);
+            }
+        }
+    }
+
+    size_t memory_bytes() const {
+        return (block_mask + 1) * sizeof(Block);
+    }
+};
+
+// Cuckoo filter with 4 x 16-bit fingerprints per bucket, each bucket one
+// 64-bit atomic word. Lookups are wait-free reads of two words; inserts and
+// erases that find room are a single CAS. Only the eviction path, taken when
+// both buckets are full, is serialized. Evictions copy a fingerprint into its
+// new bucket before clearing the old slot, so lookups never miss a key that is
+// being moved. Erasing a key while it is being inserted is not supported.
+class CuckooFilter {
+private:
+    static const int SLOTS = 4;
+    static const int MAX_KICKS = 500;
+    static constexpr double MAX_LOAD = 0.95;
+    static const size_t BATCH = 64;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    size_t bucket_mask;
+    std::mutex evict_lock;
+    std::atomic<size_t> num_items{0};
+
+    static uint16_t slot_of(uint64_t bucket, int slot) {
+        return (uint16_t)(bucket >> (slot * 16));
+    }
+
+    static uint16_t fingerprint(uint64_t hash) {
+        uint16_t fp = (uint16_t)(hash >> 48);
+        return fp == 0 ? 1 : fp;  // 0 marks an empty slot
+    }
+
+    size_t alt_index(size_t index, uint16_t fp) const {
+        return (index ^ mix64(fp)) & bucket_mask;
+    }
+
+    bool bucket_has(size_t index, uint16_t fp) const {
+        uint64_t bucket = buckets[index].load(std::memory_order_acquire);
+        for (int s = 0; s < SLOTS; s++) {
+            if (slot_of(bucket, s) == fp) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Replaces one slot holding `from` with `to`; returns the slot or -1
+    int swap_slot(size_t index, uint16_t from, uint16_t to) {
+        uint64_t bucket = buckets[index].load(std::memory_order_acquire);
+        while (true) {
+            int found = -1;
+            for (int s = 0; s < SLOTS; s++) {
+                if (slot_of(bucket, s) == from) {
+                    found = s;
+                    break;
+                }
+            }
+            if (found < 0) {
+                return -1;
+            }
+            uint64_t updated = (bucket & ~(0xffffULL << (found * 16))) | ((uint64_t)to << (found * 16));
+            if (buckets[index].compare_exchange_weak(bucket, updated, std::memory_order_acq_rel)) {
+                return found;
+            }
+        }
+    }
+
+    bool insert_hashed(uint64_t hash) {
+        size_t i1 = hash & bucket_mask;
+        uint16_t fp = fingerprint(hash);
+        size_t i2 = alt_index(i1, fp);
+
+        if (swap_slot(i1, 0, fp) >= 0 || swap_slot(i2, 0, fp) >= 0) {
+            num_items.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (evict_into(i1, fp)) {
+            num_items.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    bool contains_hashed(uint64_t hash) const {
+        size_t i1 = hash & bucket_mask;
+        uint16_t fp = fingerprint(hash);
+        return bucket_has(i1, fp) || bucket_has(alt_index(i1, fp), fp);
+    }
+
+    // Finds a chain of displacements ending in a bucket with room, then
+    // applies it from the far end back so every step has a free slot
+    bool evict_into(size_t start, uint16_t fp) {
+        std::lock_guard<std::mutex> guard(evict_lock);
+        thread_local std::minstd_rand rng(std::random_device{}());
+
+        for (int attempt = 0; attempt < 4; attempt++) {
+            size_t path_bucket[MAX_KICKS + 1];
+            uint16_t path_fp[MAX_KICKS + 1];
+            size_t index = start;
+            int len = 0;
+            bool found = false;
+            for (; len < MAX_KICKS; len++) {
+                uint64_t bucket = buckets[index].load(std::memory_order_acquire);
+                uint16_t victim = slot_of(bucket, rng() % SLOTS);
+                if (victim == 0) {
+                    path_bucket[len] = index;
+                    found = true;  // A slot opened up since we looked
+                    break;
+                }
+                path_bucket[len] = index;
+                path_fp[len] = victim;
+                index = alt_index(index, victim);
+                uint64_t next = buckets[index].load(std::memory_order_acquire);
+                bool has_room = false;
+                for (int s = 0; s < SLOTS; s++) {
+                    has_room |= slot_of(next, s) == 0;
+                }
+                if (has_room) {
+                    path_bucket[len + 1] = index;
+                    len++;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                return false;
+            }
+
+            bool applied = true;
+            for (int j = len - 1; j >= 0 && applied; j--) {
+                uint16_t moving = path_fp[j];
+                size_t dest = path_bucket[j + 1];
+                if (swap_slot(dest, 0, moving) < 0) {
+                    applied = false;  // A concurrent insert took the room
+                    break;
+                }
+                if (swap_slot(path_bucket[j], moving, 0) < 0) {
+                    swap_slot(dest, moving, 0);  // Erased while moving, drop the copy
+                }
+            }
+            if (applied && (swap_slot(start, 0, fp) >= 0 || swap_slot(alt_index(start, fp), 0, fp) >= 0)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    // The smallest power-of-two table that keeps expected_keys at or under
+    // MAX_LOAD, past which inserts start failing, so the load factor at
+    // expected_keys is between about 47.5% and 95%; see load_factor()
+    explicit CuckooFilter(size_t expected_keys) {
+        size_t num_buckets = round_up_pow2((size_t)std::ceil(expected_keys / (SLOTS * MAX_LOAD)));
+        buckets.reset(new std::atomic<uint64_t>[num_buckets]);
+        bucket_mask = num_buckets - 1;
+        for (size_t b = 0; b < num_buckets; b++) {
+            buckets[b].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Returns false when the table is too full to place the key
+    bool insert(uint64_t key) {
+        return insert_hashed(mix64(key));
+    }
+
+    bool contains(uint64_t key) const {
+        return contains_hashed(mix64(key));
+    }
+
+    // Removes one copy of the key's fingerprint; only erase keys that were inserted
+    bool erase(uint64_t key) {
+        uint64_t hash = mix64(key);
+        size_t i1 = hash & bucket_mask;
+        uint16_t fp = fingerprint(hash);
+        if (swap_slot(i1, fp, 0) >= 0 || swap_slot(alt_index(i1, fp), fp, 0) >= 0) {
+            num_items.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void contains_batch(const uint64_t *keys, bool *results, size_t n) const {
+        uint64_t hashes[BATCH];
+        for (size_t base = 0; base < n; base += BATCH) {
+            size_t len = n - base < BATCH ? n - base : BATCH;
+            hash_batch(keys + base, hashes, len);
+            for (size_t i = 0; i < len; i++) {
+                __builtin_prefetch(&buckets[hashes[i] & bucket_mask], 0);
+            }
+            for (size_t i = 0; i < len; i++) {
+                results[base + i] = contains_hashed(hashes[i]);
+            }
+        }
+    }
+
+    size_t size() const {
+        return num_items.load(std::memory_order_relaxed);
+    }
+
+    size_t memory_bytes() const {
+        return (bucket_mask + 1) * sizeof(uint64_t);
+    }
+
+    double load_factor() const {
+        return (double)size() / ((bucket_mask + 1) * SLOTS);
+    }
+};
+
+#endif // CONCURRENT_FILTERS_H
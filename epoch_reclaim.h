@@ -0,0 +1,115 @@
+#ifndef EPOCH_RECLAIM_H
+#define EPOCH_RECLAIM_H
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Epoch-based reclamation for lock-free structures whose readers can still
+// hold a pointer to a node another thread has just unlinked. Threads bracket
+// each operation with enter()/exit() (or an EpochGuard) and hand unlinked
+// nodes to retire(); a node is freed once every thread has moved two epochs
+// past the one it was retired in. Threads are identified by a dense id in
+// [0, threads), like the per-thread counters.
+class EpochReclaimer {
+private:
+    struct RetiredPtr {
+        void *ptr;
+        void (*deleter)(void *);
+    };
+
+    static const unsigned ADVANCE_EVERY = 64;  // Retires between attempts to advance
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> state{0};  // (epoch << 1) | active
+        uint64_t local_epoch{0};
+        unsigned retires{0};
+        std::vector<RetiredPtr> limbo[3];  // Indexed by retire epoch % 3
+    };
+
+    alignas(64) std::atomic<uint64_t> global_epoch{0};
+    std::unique_ptr<Slot[]> slots;
+    int num_threads;
+
+    static void free_all(std::vector<RetiredPtr>& list) {
+        for (RetiredPtr& r : list) {
+            r.deleter(r.ptr);
+        }
+        list.clear();
+    }
+
+    // Moves the global epoch on if every active thread has caught up with it
+    void try_advance() {
+        uint64_t epoch = global_epoch.load(std::memory_order_acquire);
+        for (int i = 0; i < num_threads; i++) {
+            uint64_t state = slots[i].state.load(std::memory_order_acquire);
+            if ((state & 1) && (state >> 1) != epoch) {
+                return;
+            }
+        }
+        global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+    }
+
+public:
+    EpochReclaimer(int threads) : slots(new Slot[threads]), num_threads(threads) {
+        if (threads <= 0) {
+            throw std::invalid_argument("EpochReclaimer needs at least one thread");
+        }
+    }
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    void enter(int thread_id) {
+        Slot& slot = slots[thread_id];
+        uint64_t epoch = global_epoch.load(std::memory_order_acquire);
+        // Full barrier: the pin must be visible before any shared pointer is read
+        slot.state.exchange((epoch << 1) | 1, std::memory_order_seq_cst);
+        if (epoch != slot.local_epoch) {
+            // Everything in this bucket was retired at least two epochs ago
+            free_all(slot.limbo[(epoch + 1) % 3]);
+            slot.local_epoch = epoch;
+        }
+    }
+
+    void exit(int thread_id) {
+        slots[thread_id].state.store(0, std::memory_order_release);
+    }
+
+    // Must be called between enter() and exit() by the same thread
+    template <typename T>
+    void retire(int thread_id, T *ptr) {
+        Slot& slot = slots[thread_id];
+        // Tagged with the global epoch after the unlink: any thread that can
+        // still see ptr is pinned at or before it
+        uint64_t epoch = global_epoch.load(std::memory_order_acquire);
+        slot.limbo[epoch % 3].push_back({ptr, [](void *p) { delete static_cast<T *>(p); }});
+        if (++slot.retires % ADVANCE_EVERY == 0) {
+            try_advance();
+        }
+    }
+
+    // Callers guarantee no thread is still inside enter()/exit()
+    ~EpochReclaimer() {
+        for (int i = 0; i < num_threads; i++) {
+            for (auto& list : slots[i].limbo) {
+                free_all(list);
+            }
+        }
+    }
+};
+
+class EpochGuard {
+private:
+    EpochReclaimer& reclaimer;
+    int thread_id;
+
+public:
+    EpochGuard(EpochReclaimer& r, int id) : reclaimer(r), thread_id(id) { reclaimer.enter(thread_id); }
+    ~EpochGuard() { reclaimer.exit(thread_id); }
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+#endif // EPOCH_RECLAIM_H
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include "faa_queue.h"
+#include "hand_lock_ll.h"
+
+// Every thread alternates enqueue and dequeue, the usual pairs workload for
+// comparing MPMC queues. Dequeued keys are summed to check nothing was lost.
+
+template <typename EnqueueFn, typename DequeueFn>
+long long time_pairs(int num_threads, int pairs, EnqueueFn enqueue_fn, DequeueFn dequeue_fn, long long& checksum) {
+    std::atomic<long long> sum{0};
+    std::vector<std::thread> threads;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t] {
+            long long local = 0;
+            for (int i = 0; i < pairs; i++) {
+                enqueue_fn(i, t);
+                int key;
+                while (!dequeue_fn(key, t)) {
+                    std::this_thread::yield();
+                }
+                local += key;
+            }
+            sum.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    checksum = sum.load();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+}
+
+int main(int argc, char **argv) {
+    int total_pairs = argc > 1 ? std::stoi(argv[1]) : 4000000;
+
+    std::cout << "=== Queue pairs (" << total_pairs << " enqueue/dequeue pairs split across threads) ===" << std::endl;
+    for (int num_threads = 1; num_threads <= 64; num_threads *= 4) {
+        int pairs = total_pairs / num_threads;
+        long long expected = (long long)pairs * (pairs - 1) / 2 * num_threads;
+        long long faa_sum, ms_sum, list_sum;
+
+        FaaQueue faa(num_threads);
+        long long faa_ms = time_pairs(num_threads, pairs,
+            [&](int key, int id) { faa.enqueue(key, id); },
+            [&](int& key, int id) { return faa.dequeue(key, id); }, faa_sum);
+
+        MsQueue ms(num_threads);
+        long long ms_ms = time_pairs(num_threads, pairs,
+            [&](int key, int id) { ms.enqueue(key, id); },
+            [&](int& key, int id) { return ms.dequeue(key, id); }, ms_sum);
+
+        List list{};
+        long long list_ms = time_pairs(num_threads, pairs,
+            [&](int key, int) { list.insert(key); },
+            [&](int& key, int) { return list.pop_front(key); }, list_sum);
+
+        std::cout << num_threads << " thread(s): FaaQueue " << faa_ms << " ms, Michael-Scott " << ms_ms
+                  << " ms, List " << list_ms << " ms"
+                  << ((faa_sum == expected && ms_sum == expected && list_sum == expected) ? "" : " (CHECKSUM MISMATCH)")
+                  << std::endl;
+    }
+    return 0;
+}
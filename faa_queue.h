@@ -0,0 +1,208 @@
+#ifndef FAA_QUEUE_H
+#define FAA_QUEUE_H
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include "epoch_reclaim.h"
+
+// Unbounded MPMC queue of ints built from linked fixed-size segments.
+// Enqueuers and dequeuers claim slot indices with fetch_add, like
+// SharedCounter, so contended threads each get a distinct slot instead of
+// retrying a CAS on a shared pointer. The only CAS on a shared pointer
+// happens when a segment fills up and the next one is linked in.
+// Segments are freed through an EpochReclaimer, so every call takes the
+// caller's dense thread id.
+class FaaQueue {
+private:
+    static const int SEGMENT_SIZE = 1024;
+    static const int64_t EMPTY = INT64_MIN;
+    static const int64_t TAKEN = INT64_MIN + 1;  // A dequeuer got here before the enqueuer
+
+    struct Segment {
+        alignas(64) std::atomic<int> deq_index{0};
+        alignas(64) std::atomic<int> enq_index{0};
+        alignas(64) std::atomic<Segment *> next{nullptr};
+        std::atomic<int64_t> items[SEGMENT_SIZE];
+
+        Segment() {
+            for (int i = 0; i < SEGMENT_SIZE; i++) {
+                items[i].store(EMPTY, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    alignas(64) std::atomic<Segment *> head;
+    alignas(64) std::atomic<Segment *> tail;
+    EpochReclaimer reclaimer;
+
+public:
+    FaaQueue(int threads) : reclaimer(threads) {
+        Segment *first = new Segment;
+        head.store(first, std::memory_order_relaxed);
+        tail.store(first, std::memory_order_relaxed);
+    }
+
+    FaaQueue(const FaaQueue&) = delete;
+    FaaQueue& operator=(const FaaQueue&) = delete;
+
+    void enqueue(int key, int thread_id) {
+        EpochGuard guard(reclaimer, thread_id);
+        while (true) {
+            Segment *last = tail.load(std::memory_order_acquire);
+            int index = last->enq_index.fetch_add(1, std::memory_order_relaxed);
+            if (index < SEGMENT_SIZE) {
+                int64_t expected = EMPTY;
+                if (last->items[index].compare_exchange_strong(expected, key, std::memory_order_release,
+                                                               std::memory_order_relaxed)) {
+                    return;
+                }
+                continue;  // A dequeuer poisoned the slot; claim another
+            }
+
+            // Segment full: link a new one that already holds our key
+            if (last != tail.load(std::memory_order_acquire)) {
+                continue;
+            }
+            Segment *next = last->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                Segment *created = new Segment;
+                created->enq_index.store(1, std::memory_order_relaxed);
+                created->items[0].store(key, std::memory_order_relaxed);
+                if (last->next.compare_exchange_strong(next, created, std::memory_order_acq_rel)) {
+                    tail.compare_exchange_strong(last, created, std::memory_order_acq_rel);
+                    return;
+                }
+                delete created;
+            } else {
+                tail.compare_exchange_strong(last, next, std::memory_order_acq_rel);
+            }
+        }
+    }
+
+    // Returns false if the queue was empty
+    bool dequeue(int& key, int thread_id) {
+        EpochGuard guard(reclaimer, thread_id);
+        while (true) {
+            Segment *first = head.load(std::memory_order_acquire);
+            if (first->deq_index.load(std::memory_order_relaxed) >= first->enq_index.load(std::memory_order_relaxed)
+                && first->next.load(std::memory_order_acquire) == nullptr) {
+                return false;
+            }
+            int index = first->deq_index.fetch_add(1, std::memory_order_relaxed);
+            if (index >= SEGMENT_SIZE) {
+                // Segment drained: move head on and retire it
+                Segment *next = first->next.load(std::memory_order_acquire);
+                if (next == nullptr) {
+                    return false;
+                }
+                // An enqueuer may have linked next without moving tail yet;
+                // move it ourselves so tail never points at a retired segment
+                Segment *last = first;
+                tail.compare_exchange_strong(last, next, std::memory_order_acq_rel);
+                if (head.compare_exchange_strong(first, next, std::memory_order_acq_rel)) {
+                    reclaimer.retire(thread_id, first);
+                }
+                continue;
+            }
+            int64_t item = first->items[index].exchange(TAKEN, std::memory_order_acquire);
+            if (item == EMPTY) {
+                continue;  // Enqueuer claimed this slot but hasn't written it yet
+            }
+            key = (int)item;
+            return true;
+        }
+    }
+
+    // Callers guarantee no other thread is using the queue
+    ~FaaQueue() {
+        Segment *curr = head.load(std::memory_order_relaxed);
+        while (curr != nullptr) {
+            Segment *next = curr->next.load(std::memory_order_relaxed);
+            delete curr;
+            curr = next;
+        }
+    }
+};
+
+// Michael & Scott's lock-free queue, the CAS-based baseline: every enqueue
+// and dequeue retries a CAS on the shared tail or head until it wins
+class MsQueue {
+private:
+    struct Node {
+        int key{0};
+        std::atomic<Node *> next{nullptr};
+    };
+
+    alignas(64) std::atomic<Node *> head;
+    alignas(64) std::atomic<Node *> tail;
+    EpochReclaimer reclaimer;
+
+public:
+    MsQueue(int threads) : reclaimer(threads) {
+        Node *dummy = new Node;
+        head.store(dummy, std::memory_order_relaxed);
+        tail.store(dummy, std::memory_order_relaxed);
+    }
+
+    MsQueue(const MsQueue&) = delete;
+    MsQueue& operator=(const MsQueue&) = delete;
+
+    void enqueue(int key, int thread_id) {
+        Node *node = new Node;
+        node->key = key;
+        EpochGuard guard(reclaimer, thread_id);
+        while (true) {
+            Node *last = tail.load(std::memory_order_acquire);
+            Node *next = last->next.load(std::memory_order_acquire);
+            if (last != tail.load(std::memory_order_acquire)) {
+                continue;
+            }
+            if (next == nullptr) {
+                if (last->next.compare_exchange_weak(next, node, std::memory_order_release,
+                                                     std::memory_order_relaxed)) {
+                    tail.compare_exchange_strong(last, node, std::memory_order_release);
+                    return;
+                }
+            } else {
+                tail.compare_exchange_strong(last, next, std::memory_order_release);
+            }
+        }
+    }
+
+    bool dequeue(int& key, int thread_id) {
+        EpochGuard guard(reclaimer, thread_id);
+        while (true) {
+            Node *first = head.load(std::memory_order_acquire);
+            Node *last = tail.load(std::memory_order_acquire);
+            Node *next = first->next.load(std::memory_order_acquire);
+            if (first != head.load(std::memory_order_acquire)) {
+                continue;
+            }
+            if (next == nullptr) {
+                return false;
+            }
+            if (first == last) {
+                tail.compare_exchange_strong(last, next, std::memory_order_release);
+                continue;
+            }
+            int value = next->key;
+            if (head.compare_exchange_weak(first, next, std::memory_order_acq_rel)) {
+                key = value;
+                reclaimer.retire(thread_id, first);
+                return true;
+            }
+        }
+    }
+
+    ~MsQueue() {
+        Node *curr = head.load(std::memory_order_relaxed);
+        while (curr != nullptr) {
+            Node *next = curr->next.load(std::memory_order_relaxed);
+            delete curr;
+            curr = next;
+        }
+    }
+};
+
+#endif // FAA_QUEUE_H
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include "flight_recorder.h"
+
+// Offline decoder for flight_dump() files: merges every thread's ring into one
+// timeline sorted by TSC and prints it as CSV, followed by per-op totals.
+
+struct DecodedEntry {
+    uint32_t thread;
+    FlightEntry entry;
+};
+
+const char *op_name(uint16_t op) {
+    switch (op) {
+    case FR_LIST_INSERT: return "list_insert";
+    case FR_LIST_CONTAINS: return "list_contains";
+    case FR_LIST_CLEAR: return "list_clear";
+    case FR_COUNTER_INCREMENT: return "counter_increment";
+    case FR_SHARED_INCREMENT: return "shared_increment";
+    case FR_ADAPTIVE_INFLATE: return "adaptive_inflate";
+    case FR_ADAPTIVE_DEFLATE: return "adaptive_deflate";
+    default: return "unknown";
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " <flight.bin>" << std::endl;
+        return 1;
+    }
+    std::ifstream in(argv[1], std::ios::binary);
+    FlightFileHeader header;
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header))
+        || std::memcmp(header.magic, FLIGHT_MAGIC, sizeof(header.magic)) != 0
+        || header.version != FLIGHT_VERSION || header.ring_size == 0) {
+        std::cout << "Not a flight recorder dump: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::vector<DecodedEntry> timeline;
+    std::vector<FlightEntry> ring(header.ring_size);
+    for (uint32_t r = 0; r < header.num_rings; r++) {
+        FlightRingHeader ring_header;
+        if (!in.read(reinterpret_cast<char *>(&ring_header), sizeof(ring_header))
+            || !in.read(reinterpret_cast<char *>(ring.data()), ring.size() * sizeof(FlightEntry))) {
+            std::cout << "Truncated dump at ring " << r << std::endl;
+            return 1;
+        }
+        // Oldest surviving entry first
+        uint64_t kept = std::min<uint64_t>(ring_header.written, header.ring_size);
+        for (uint64_t i = ring_header.written - kept; i < ring_header.written; i++) {
+            timeline.push_back({ring_header.thread_index, ring[i % header.ring_size]});
+        }
+    }
+    if (timeline.empty()) {
+        std::cout << "No entries recorded" << std::endl;
+        return 0;
+    }
+
+    std::sort(timeline.begin(), timeline.end(), [](const DecodedEntry& a, const DecodedEntry& b) {
+        return a.entry.tsc < b.entry.tsc;
+    });
+
+    double tsc_per_ns = header.tsc_per_ns > 0 ? header.tsc_per_ns : 1.0;
+    uint64_t origin = timeline.front().entry.tsc;
+    uint64_t counts[FR_ADAPTIVE_DEFLATE + 1] = {};
+    double wait_ns[FR_ADAPTIVE_DEFLATE + 1] = {};
+
+    std::cout << "time_ns,thread,op,key,outcome,lock_wait_ns\n";
+    for (const DecodedEntry& d : timeline) {
+        const FlightEntry& e = d.entry;
+        double lock_wait = e.lock_wait / tsc_per_ns;
+        std::cout << (uint64_t)((e.tsc - origin) / tsc_per_ns) << ',' << d.thread << ','
+                  << op_name(e.op) << ',' << e.key << ',' << (int)e.outcome << ','
+                  << (uint64_t)lock_wait << '\n';
+        if (e.op <= FR_ADAPTIVE_DEFLATE) {
+            counts[e.op]++;
+            wait_ns[e.op] += lock_wait;
+        }
+    }
+
+    std::cout << "\n# op,count,mean_lock_wait_ns\n";
+    for (uint16_t op = FR_LIST_INSERT; op <= FR_ADAPTIVE_DEFLATE; op++) {
+        if (counts[op]) {
+            std::cout << "# " << op_name(op) << ',' << counts[op] << ','
+                      << (uint64_t)(wait_ns[op] / counts[op]) << '\n';
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+// Per-thread trace rings for data-structure operations. Build with
+// -DFLIGHT_RECORDER to enable; otherwise FR_STAMP/FR_RECORD expand to nothing
+// and the hot paths are unchanged. Dump with flight_dump() or by sending the
+// signal passed to flight_install_signal_handler(), then decode the file
+// with flight_decode.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+enum FlightOp : uint16_t {
+    FR_LIST_INSERT = 1,
+    FR_LIST_CONTAINS,
+    FR_LIST_CLEAR,
+    FR_COUNTER_INCREMENT,
+    FR_SHARED_INCREMENT,
+    FR_ADAPTIVE_INFLATE,
+    FR_ADAPTIVE_DEFLATE,
+};
+
+struct FlightEntry {
+    uint64_t tsc;
+    int32_t key;
+    uint32_t lock_wait;  // TSC ticks spent waiting for a lock, 0 if none
+    uint16_t op;
+    uint8_t outcome;     // Op-specific: retries, found/not found, ...
+    uint8_t pad[5];
+};
+
+static const uint32_t FLIGHT_RING_SIZE = 4096;  // Entries per thread, power of two
+static const uint32_t FLIGHT_MAX_RINGS = 256;
+static const char FLIGHT_MAGIC[4] = {'F', 'L', 'T', 'R'};
+static const uint32_t FLIGHT_VERSION = 1;
+
+// File layout: FlightFileHeader, then per ring a FlightRingHeader followed by
+// FLIGHT_RING_SIZE raw entries. Entry i of a ring lives at i % FLIGHT_RING_SIZE.
+struct FlightFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t num_rings;
+    uint32_t ring_size;
+    double tsc_per_ns;
+};
+
+struct FlightRingHeader {
+    uint32_t thread_index;
+    uint32_t pad;
+    uint64_t written;  // Total entries ever written; the newest ring_size survive
+};
+
+struct FlightRing {
+    std::atomic<uint64_t> written{0};
+    uint32_t thread_index{0};
+    FlightEntry entries[FLIGHT_RING_SIZE];
+};
+
+inline uint64_t flight_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Rings are never freed, so a dump (even from a signal handler) can walk
+// them without locks after their threads have exited
+struct FlightRegistry {
+    FlightRing *rings[FLIGHT_MAX_RINGS];
+    std::atomic<uint32_t> count{0};
+    double tsc_per_ns{1.0};
+    char signal_path[256];
+};
+
+inline FlightRegistry& flight_registry() {
+    static FlightRegistry registry;
+    return registry;
+}
+
+inline FlightRing *flight_thread_ring() {
+    thread_local FlightRing *ring = [] {
+        FlightRegistry& registry = flight_registry();
+        uint32_t index = registry.count.load(std::memory_order_relaxed);
+        if (index >= FLIGHT_MAX_RINGS) {
+            return (FlightRing *)nullptr;  // Out of rings: this thread goes unrecorded
+        }
+        FlightRing *created = new FlightRing;
+        created->thread_index = index;
+        while (!registry.count.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel)) {
+            if (index >= FLIGHT_MAX_RINGS) {
+                delete created;
+                return (FlightRing *)nullptr;
+            }
+            created->thread_index = index;
+        }
+        registry.rings[index] = created;
+        return created;
+    }();
+    return ring;
+}
+
+inline void flight_record(uint16_t op, int32_t key, uint8_t outcome, uint64_t lock_wait) {
+    FlightRing *ring = flight_thread_ring();
+    if (ring == nullptr) {
+        return;
+    }
+    uint64_t n = ring->written.load(std::memory_order_relaxed);
+    FlightEntry& entry = ring->entries[n % FLIGHT_RING_SIZE];
+    entry.tsc = flight_tsc();
+    entry.key = key;
+    entry.lock_wait = lock_wait > UINT32_MAX ? UINT32_MAX : (uint32_t)lock_wait;
+    entry.op = op;
+    entry.outcome = outcome;
+    ring->written.store(n + 1, std::memory_order_release);
+}
+
+// Measures TSC ticks per ns so the decoder can convert; call once at startup
+inline void flight_calibrate() {
+    auto start_time = std::chrono::steady_clock::now();
+    uint64_t start_tsc = flight_tsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t end_tsc = flight_tsc();
+    auto end_time = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end_time - start_time).count();
+    flight_registry().tsc_per_ns = ns > 0 ? (end_tsc - start_tsc) / ns : 1.0;
+}
+
+// Only open/write/close, so this is async-signal-safe. Entries being written
+// while the dump runs may come out torn.
+inline int flight_dump(const char *path) {
+    FlightRegistry& registry = flight_registry();
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    uint32_t num_rings = registry.count.load(std::memory_order_acquire);
+    if (num_rings > FLIGHT_MAX_RINGS) {
+        num_rings = FLIGHT_MAX_RINGS;
+    }
+
+    FlightFileHeader header;
+    std::memcpy(header.magic, FLIGHT_MAGIC, sizeof(header.magic));
+    header.version = FLIGHT_VERSION;
+    header.num_rings = num_rings;
+    header.ring_size = FLIGHT_RING_SIZE;
+    header.tsc_per_ns = registry.tsc_per_ns;
+    bool ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header);
+
+    for (uint32_t i = 0; ok && i < num_rings; i++) {
+        FlightRing *ring = registry.rings[i];
+        FlightRingHeader ring_header;
+        ring_header.thread_index = ring ? ring->thread_index : i;
+        ring_header.pad = 0;
+        ring_header.written = ring ? ring->written.load(std::memory_order_acquire) : 0;
+        ok = write(fd, &ring_header, sizeof(ring_header)) == (ssize_t)sizeof(ring_header);
+        if (ok && ring != nullptr) {
+            ok = write(fd, ring->entries, sizeof(ring->entries)) == (ssize_t)sizeof(ring->entries);
+        } else if (ok) {
+            static const FlightEntry blank[64] = {};
+            for (uint32_t written = 0; ok && written < FLIGHT_RING_SIZE; written += 64) {
+                ok = write(fd, blank, sizeof(blank)) == (ssize_t)sizeof(blank);
+            }
+        }
+    }
+    return (close(fd) == 0 && ok) ? 0 : -1;
+}
+
+// Dumps to path whenever `sig` arrives (e.g. kill -USR1 <pid>)
+inline void flight_install_signal_handler(const char *path, int sig = SIGUSR1) {
+    FlightRegistry& registry = flight_registry();
+    std::strncpy(registry.signal_path, path, sizeof(registry.signal_path) - 1);
+    registry.signal_path[sizeof(registry.signal_path) - 1] = '\0';
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = [](int) { flight_dump(flight_registry().signal_path); };
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(sig, &action, nullptr);
+}
+
+#ifdef FLIGHT_RECORDER
+#define FR_STAMP(name) uint64_t name = flight_tsc()
+#define FR_ELAPSED(since) (flight_tsc() - (since))
+#define FR_RECORD(op, key, outcome, lock_wait) flight_record((op), (key), (outcome), (lock_wait))
+#else
+#define FR_STAMP(name) do {} while (0)
+#define FR_ELAPSED(since) 0
+#define FR_RECORD(op, key, outcome, lock_wait) do {} while (0)
+#endif
+
+#endif // FLIGHT_RECORDER_H
@@ -1,71 +1,497 @@
-#include <thread>
 #include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdio>
 #include <vector>
+#include <thread>
 #include <atomic>
-#include <chrono>
-#include <mutex>  // Add this
+#include <shared_mutex>
+#include <algorithm>
+#include <random>
+#include "hand_lock_ll.h"
 
-typedef struct __node_t{
-    int key;
-    struct __node_t * next{nullptr};
-    std::mutex n_lock{};
-} node_t;
-
-class List{
-    node_t *head{nullptr};
-    node_t *tail{nullptr};
-    int size{1000};
-
-public:
-    int insert(int key){
-        node_t *new_node = new node_t; 
-        if (new_node == nullptr){
-            return -1;
+// Builds a list of n nodes and reports how long the caller is blocked tearing it down
+void bench_teardown(int n){
+    std::cout << "=== Teardown latency (" << n << " nodes) ===" << std::endl;
+    for (int background = 0; background < 2; background++) {
+        List list{};
+        for (int i = 0; i < n; i++) {
+            list.insert(i);
         }
-        
-        new_node->key = key;
-        new_node->next = nullptr;
-        
-        // Handle first insertion
-        if (tail == nullptr) {
-            head = tail = new_node;
-            return 0;
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        if (background) {
+            list.clear();
+        } else {
+            list.clear_now();
         }
-        
-        // Lock the current tail
-        tail->n_lock.lock();
-        tail->next = new_node;
-        node_t *old_tail = tail;
-        tail = new_node;
-        old_tail->n_lock.unlock(); 
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
 
-        return 0;
+        std::cout << (background ? "clear() (background reclaimer): " : "clear_now() (inline walk):      ")
+                  << duration.count() << " us" << std::endl;
     }
+}
 
+// Compares rebuilding a list by re-inserting every key against save()/load()
+void bench_snapshot(int n, const char *path){
+    std::cout << "=== Snapshot save/load (" << n << " nodes) ===" << std::endl;
+    List source{};
+    for (int i = 0; i < n; i++) {
+        source.insert(i);
+    }
 
-    void traverse(){
-	    node_t *curr = head;
-	    while (curr != nullptr){
-		curr->n_lock.lock();
-		std::cout<< curr->key << '\n';
-		curr->n_lock.unlock();
-		curr = curr->next;
-	   }
+    auto start_time = std::chrono::high_resolution_clock::now();
+    if (source.save(path) != 0) {
+        std::cout << "save failed: " << path << std::endl;
+        return;
     }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::cout << "save():           " << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
+              << " ms" << std::endl;
 
+    {
+        List rebuilt{};
+        start_time = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < n; i++) {
+            rebuilt.insert(i);
+        }
+        end_time = std::chrono::high_resolution_clock::now();
+        std::cout << "insert rebuild:   " << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
+                  << " ms" << std::endl;
+    }
 
-   
-    
-    ~List() {
-        while (head != nullptr) {
-            node_t *temp = head;
-            head = head->next;
-            delete temp;  
+    {
+        List loaded{};
+        start_time = std::chrono::high_resolution_clock::now();
+        if (loaded.load(path) != 0) {
+            std::cout << "load failed: " << path << std::endl;
+            return;
         }
+        end_time = std::chrono::high_resolution_clock::now();
+        std::cout << "load() via mmap:  " << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
+                  << " ms" << std::endl;
+    }
+    std::remove(path);
+}
+
+// Read-mostly lookups on a short list, so the structure lock dominates
+template <typename StructureLock>
+long long time_lookups(int num_threads, int lookups){
+    BasicList<StructureLock> list{};
+    for (int i = 0; i < 16; i++) {
+        list.insert(i);
+    }
+
+    std::vector<std::thread> threads;
+    std::atomic<int> found{0};
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&list, &found, lookups, t]{
+            int hits = 0;
+            for (int i = 0; i < lookups; i++) {
+                hits += list.contains((i + t) % 32);
+            }
+            found.fetch_add(hits, std::memory_order_relaxed);
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+}
+
+// Bare lock_shared/unlock_shared pairs, no list work in between
+template <typename StructureLock>
+long long time_read_acquires(int num_threads, int acquires){
+    StructureLock lock;
+    std::vector<std::thread> threads;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&lock, acquires]{
+            for (int i = 0; i < acquires; i++) {
+                lock.lock_shared();
+                lock.unlock_shared();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+}
+
+void bench_rwlock(int lookups){
+    std::cout << "=== Structure lock read scaling (" << lookups << " lookups per thread) ===" << std::endl;
+    for (int num_threads = 1; num_threads <= 16; num_threads *= 2) {
+        long long shared_ms = time_lookups<std::shared_mutex>(num_threads, lookups);
+        long long distributed_ms = time_lookups<DistributedRWLock>(num_threads, lookups);
+        long long shared_acq_ms = time_read_acquires<std::shared_mutex>(num_threads, lookups * 10);
+        long long distributed_acq_ms = time_read_acquires<DistributedRWLock>(num_threads, lookups * 10);
+        std::cout << num_threads << " thread(s): contains() std::shared_mutex " << shared_ms
+                  << " ms, DistributedRWLock " << distributed_ms << " ms; bare read acquires "
+                  << shared_acq_ms << " ms vs " << distributed_acq_ms << " ms" << std::endl;
+    }
+}
+
+// Every insert goes through the tail node's lock, so concurrent appenders
+// contend on node locks
+template <typename NodeLock>
+long long time_inserts(int num_threads, int inserts){
+    BasicList<std::shared_mutex, NodeLock> list{};
+    std::vector<std::thread> threads;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&list, inserts, t]{
+            for (int i = 0; i < inserts; i++) {
+                list.insert(t * inserts + i);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
     }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    list.clear_now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+}
+
+void bench_nodelock(int inserts){
+    unsigned cpus = std::thread::hardware_concurrency();
+    int fitting = cpus ? cpus : 1;
+    std::cout << "=== Node lock policy (" << inserts << " inserts per thread, " << fitting << " CPUs) ===" << std::endl;
+    for (int num_threads : {fitting, fitting * 4}) {
+        long long mutex_ms = time_inserts<std::mutex>(num_threads, inserts);
+        long long adaptive_ms = time_inserts<AdaptiveSpinLock>(num_threads, inserts);
+        std::cout << num_threads << " thread(s)" << (num_threads > fitting ? " (oversubscribed)" : "")
+                  << ": std::mutex " << mutex_ms << " ms, AdaptiveSpinLock " << adaptive_ms << " ms" << std::endl;
+    }
+}
+
+struct Item : list_hook {
+    int key;
 };
 
-int main(){
+// Appends n elements from num_threads threads, then drains them from the front
+template <typename InsertFn, typename DrainFn>
+void time_fill_drain(int num_threads, int n, InsertFn insert_fn, DrainFn drain_fn,
+                     long long& insert_ms, long long& drain_ms){
+    int per_thread = n / num_threads;
+    std::vector<std::thread> threads;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&insert_fn, per_thread, t]{
+            for (int i = t * per_thread; i < (t + 1) * per_thread; i++) {
+                insert_fn(i);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto mid_time = std::chrono::high_resolution_clock::now();
+    drain_fn();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    insert_ms = std::chrono::duration_cast<std::chrono::milliseconds>(mid_time - start_time).count();
+    drain_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - mid_time).count();
+}
+
+// Allocating List against IntrusiveList over objects the caller already owns
+void bench_intrusive(int n){
+    std::cout << "=== Intrusive vs allocating List (" << n << " elements) ===" << std::endl;
+    std::vector<Item> items(n);
+    for (int i = 0; i < n; i++) {
+        items[i].key = i;
+    }
+
+    for (int num_threads : {1, 4}) {
+        long long list_insert_ms, list_drain_ms, intrusive_insert_ms, intrusive_drain_ms;
+        long long list_sum = 0, intrusive_sum = 0;
+
+        List list{};
+        time_fill_drain(num_threads, n, [&list](int i){ list.insert(i); },
+                        [&]{ int key; while (list.pop_front(key)) list_sum += key; },
+                        list_insert_ms, list_drain_ms);
+
+        IntrusiveList<Item> intrusive{};
+        time_fill_drain(num_threads, n, [&](int i){ intrusive.insert(&items[i]); },
+                        [&]{ while (Item *item = intrusive.pop_front()) intrusive_sum += item->key; },
+                        intrusive_insert_ms, intrusive_drain_ms);
+
+        std::cout << num_threads << " thread(s): List insert " << list_insert_ms << " ms, drain "
+                  << list_drain_ms << " ms; IntrusiveList insert " << intrusive_insert_ms
+                  << " ms, drain " << intrusive_drain_ms << " ms"
+                  << (list_sum == intrusive_sum ? "" : " (SUM MISMATCH)") << std::endl;
+    }
+
+    // remove() of a middle element, the case an allocating list can't do by pointer
+    IntrusiveList<Item> intrusive{};
+    for (int i = 0; i < 1000; i++) {
+        intrusive.insert(&items[i]);
+    }
+    bool removed = intrusive.remove(&items[500]) && !intrusive.contains(&items[500]);
+    std::cout << "remove(middle): " << (removed ? "ok" : "FAILED") << std::endl;
+    intrusive.clear();
+}
+
+// Parallel in-place List::sort against copying the keys out, std::sort and
+// writing them back into the same nodes
+void bench_sort(const std::vector<int>& sizes){
+    unsigned cpus = std::thread::hardware_concurrency();
+    std::cout << "=== List sort (" << (cpus ? cpus : 1) << " threads) ===" << std::endl;
+    for (int n : sizes) {
+        long long sort_ms, copy_ms;
+        bool sort_ok, copy_ok;
+        {
+            List list{};
+            std::mt19937 rng(n);
+            for (int i = 0; i < n; i++) {
+                list.insert((int)(rng() >> 1));
+            }
+            auto start_time = std::chrono::high_resolution_clock::now();
+            list.sort();
+            auto end_time = std::chrono::high_resolution_clock::now();
+            sort_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+            sort_ok = list.is_sorted();
+            list.clear_now();
+        }
+        {
+            List list{};
+            std::mt19937 rng(n);
+            for (int i = 0; i < n; i++) {
+                list.insert((int)(rng() >> 1));
+            }
+            auto start_time = std::chrono::high_resolution_clock::now();
+            std::vector<int> keys;
+            keys.reserve(n);
+            list.for_each([&](int& key){ keys.push_back(key); });
+            std::sort(keys.begin(), keys.end());
+            size_t i = 0;
+            list.for_each([&](int& key){ key = keys[i++]; });
+            auto end_time = std::chrono::high_resolution_clock::now();
+            copy_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+            copy_ok = list.is_sorted();
+            list.clear_now();
+        }
+        std::cout << n << " nodes: List::sort " << sort_ms << " ms" << (sort_ok ? "" : " (NOT SORTED)")
+                  << ", copy-out std::sort " << copy_ms << " ms" << (copy_ok ? "" : " (NOT SORTED)") << std::endl;
+    }
+}
+
+// Sequential for_each against parallel_reduce over the skip index, then the
+// same scans while another thread keeps appending
+void bench_pscan(int n){
+    std::cout << "=== Parallel scan (" << n << " nodes) ===" << std::endl;
+    List list{};
+    for (int i = 0; i < n; i++) {
+        list.insert(1);
+    }
+    auto plus = [](long long a, long long b){ return a + b; };
+    auto as_long = [](int key){ return (long long)key; };
+
+    long long count = 0;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    list.for_each([&count](int& key){ count += key; });
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::cout << "for_each:                  " << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
+              << " ms, sum " << count << std::endl;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    list.parallel_reduce(0LL, as_long, plus, 1);
+    end_time = std::chrono::high_resolution_clock::now();
+    std::cout << "first scan (builds index): " << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
+              << " ms" << std::endl;
+
+    for (int num_threads : {1, 2, 4, 8}) {
+        start_time = std::chrono::high_resolution_clock::now();
+        long long sum = list.parallel_reduce(0LL, as_long, plus, num_threads);
+        end_time = std::chrono::high_resolution_clock::now();
+        std::cout << "parallel_reduce " << num_threads << " thread(s): "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
+                  << " ms, sum " << sum << std::endl;
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<long long> appended{0};
+    std::thread appender([&]{
+        while (!done.load(std::memory_order_relaxed)) {
+            list.insert(1);
+            appended.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    bool consistent = true;
+    long long last = n;
+    for (int round = 0; round < 8; round++) {
+        // Every scan sees a prefix that only grows
+        long long sum = list.parallel_reduce(0LL, as_long, plus, 4);
+        consistent = consistent && sum >= last;
+        last = sum;
+    }
+    done.store(true);
+    appender.join();
+    std::cout << "8 scans during " << appended.load() << " concurrent appends: "
+              << (consistent && last <= n + appended.load() ? "consistent" : "INCONSISTENT") << std::endl;
+}
+
+// Evicts the list from cache by streaming through a buffer larger than the LLC
+void flush_caches(){
+    static std::vector<char> junk(256 << 20);
+    for (size_t i = 0; i < junk.size(); i += 64) {
+        junk[i]++;
+    }
+}
+
+// ns per node for a full contains() miss at several prefetch distances. The
+// cold list is sorted by random keys first so consecutive nodes are scattered
+// in memory and the hardware prefetcher can't follow them.
+void bench_prefetch(int cold_n, int warm_n){
+    std::cout << "=== Prefetch distance (cold " << cold_n << " nodes, warm " << warm_n << " nodes) ===" << std::endl;
+    List cold{};
+    List warm{};
+    std::mt19937 rng(42);
+    for (int i = 0; i < cold_n; i++) {
+        cold.insert((int)(rng() >> 1));
+    }
+    for (int i = 0; i < warm_n; i++) {
+        warm.insert((int)(rng() >> 1));
+    }
+    cold.sort();
+    warm.sort();
+
+    for (int distance : {0, 2, 4, 8, 16, 32}) {
+        cold.set_prefetch_distance(distance);
+        warm.set_prefetch_distance(distance);
+
+        double cold_ns = 0;
+        for (int round = 0; round < 3; round++) {
+            flush_caches();
+            auto start_time = std::chrono::high_resolution_clock::now();
+            cold.contains(-1);
+            auto end_time = std::chrono::high_resolution_clock::now();
+            cold_ns += std::chrono::duration<double, std::nano>(end_time - start_time).count() / cold_n / 3;
+        }
+
+        const int WARM_ROUNDS = 50;
+        warm.contains(-1);
+        auto start_time = std::chrono::high_resolution_clock::now();
+        for (int round = 0; round < WARM_ROUNDS; round++) {
+            warm.contains(-1);
+        }
+        auto end_time = std::chrono::high_resolution_clock::now();
+        double warm_ns = std::chrono::duration<double, std::nano>(end_time - start_time).count() / warm_n / WARM_ROUNDS;
+
+        std::cout << "distance " << distance << (distance == 0 ? " (off)" : "") << ": cold "
+                  << cold_ns << " ns/node, warm " << warm_ns << " ns/node" << std::endl;
+    }
+}
+
+// Cold full-list walk in ns per node
+double cold_walk_ns(List& list, int n){
+    flush_caches();
+    auto start_time = std::chrono::high_resolution_clock::now();
+    list.contains(-1);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end_time - start_time).count() / n;
+}
+
+// Traversal speed of a churned (scattered) list before and after compact(),
+// with an appender running during the compaction
+void bench_compact(int n){
+    std::cout << "=== Compaction (" << n << " nodes) ===" << std::endl;
+    List list{};
+    std::mt19937 rng(7);
+    for (int i = 0; i < n; i++) {
+        list.insert((int)(rng() >> 1));
+    }
+    list.sort();  // Relinks in random address order, like long churn would
+
+    list.set_prefetch_distance(0);
+    double before_plain = cold_walk_ns(list, n);
+    list.set_prefetch_distance(8);
+    double before_prefetch = cold_walk_ns(list, n);
+
+    std::atomic<bool> done{false};
+    std::atomic<long long> appended{0};
+    // Paced so the appended nodes don't swamp the after measurement
+    std::thread appender([&]{
+        while (!done.load(std::memory_order_relaxed)) {
+            list.insert(INT32_MAX);
+            appended.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+    auto start_time = std::chrono::high_resolution_clock::now();
+    long long moved = list.compact();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    done.store(true);
+    appender.join();
+
+    long long total = 0;
+    list.for_each([&total](int&){ total++; });
+    int walked = (int)total;
+
+    list.set_prefetch_distance(0);
+    double after_plain = cold_walk_ns(list, walked);
+    list.set_prefetch_distance(8);
+    double after_prefetch = cold_walk_ns(list, walked);
+
+    std::cout << "compact(): " << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count()
+              << " ms, " << moved << " nodes relocated, " << appended.load() << " appended meanwhile"
+              << (total == n + appended.load() ? "" : " (NODES LOST)") << std::endl;
+    std::cout << "cold walk, no prefetch: " << before_plain << " -> " << after_plain << " ns/node" << std::endl;
+    std::cout << "cold walk, prefetch 8:  " << before_prefetch << " -> " << after_prefetch << " ns/node" << std::endl;
+}
+
+int main(int argc, char **argv){
+    Instrument::report_at_exit();
+#ifdef FLIGHT_RECORDER
+    flight_calibrate();
+    flight_install_signal_handler("flight.bin");
+    struct DumpAtExit { ~DumpAtExit() { flight_dump("flight.bin"); } } dump_at_exit;
+#endif
+    if (argc > 1 && std::string(argv[1]) == "teardown") {
+        bench_teardown(argc > 2 ? std::stoi(argv[2]) : 10000000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "rwlock") {
+        bench_rwlock(argc > 2 ? std::stoi(argv[2]) : 200000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "nodelock") {
+        bench_nodelock(argc > 2 ? std::stoi(argv[2]) : 500000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "intrusive") {
+        bench_intrusive(argc > 2 ? std::stoi(argv[2]) : 2000000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "sort") {
+        std::vector<int> sizes;
+        for (int i = 2; i < argc; i++) {
+            sizes.push_back(std::stoi(argv[i]));
+        }
+        bench_sort(sizes.empty() ? std::vector<int>{1000000, 10000000} : sizes);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "pscan") {
+        bench_pscan(argc > 2 ? std::stoi(argv[2]) : 10000000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "prefetch") {
+        bench_prefetch(argc > 2 ? std::stoi(argv[2]) : 4000000, argc > 3 ? std::stoi(argv[3]) : 16384);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "compact") {
+        bench_compact(argc > 2 ? std::stoi(argv[2]) : 4000000);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "snapshot") {
+        bench_snapshot(argc > 2 ? std::stoi(argv[2]) : 10000000, argc > 3 ? argv[3] : "list.snapshot");
+        return 0;
+    }
+
     List list{};
     list.insert(5);
     list.insert(6);
@@ -0,0 +1,970 @@
+#ifndef HAND_LOCK_LL_H
+#define HAND_LOCK_LL_H
+
+#include <thread>
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <mutex>  // Add this
+#include <shared_mutex>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "locks.h"
+#include "async_logger.h"
+#include "flight_recorder.h"
+#include "instrument.h"
+
+template <typename NodeLock = std::mutex>
+struct basic_node{
+    int key;
+    bool in_arena{false};  // Part of a bulk-allocated block, never deleted on its own
+    basic_node * next{nullptr};
+    // A node further down the list, only ever prefetched (never dereferenced)
+    std::atomic<basic_node *> jump{nullptr};
+    NodeLock n_lock{};
+};
+
+typedef basic_node<> node_t;
+
+// Something handed to the reclaimer; the destructor does the actual freeing
+struct Retired {
+    virtual ~Retired() = default;
+};
+
+// Background thread that frees detached node chains off the caller's thread
+class NodeReclaimer {
+    std::mutex queue_lock;
+    std::condition_variable queue_cv;
+    std::vector<std::unique_ptr<Retired>> queue;
+    bool stopping{false};
+    std::thread worker;
+
+    void run(){
+        std::unique_lock<std::mutex> guard(queue_lock);
+        while (true) {
+            queue_cv.wait(guard, [this]{ return stopping || !queue.empty(); });
+            if (queue.empty() && stopping) {
+                return;
+            }
+            std::vector<std::unique_ptr<Retired>> batch;
+            batch.swap(queue);
+            guard.unlock();
+            batch.clear();  // Frees every retired chain
+            guard.lock();
+        }
+    }
+
+public:
+    NodeReclaimer() : worker(&NodeReclaimer::run, this) {}
+
+    void retire(std::unique_ptr<Retired> item){
+        {
+            std::lock_guard<std::mutex> guard(queue_lock);
+            queue.push_back(std::move(item));
+        }
+        queue_cv.notify_one();
+    }
+
+    // Drains everything queued so far before returning
+    ~NodeReclaimer() {
+        {
+            std::lock_guard<std::mutex> guard(queue_lock);
+            stopping = true;
+        }
+        queue_cv.notify_one();
+        worker.join();
+    }
+};
+
+inline NodeReclaimer& background_reclaimer(){
+    static NodeReclaimer reclaimer;
+    return reclaimer;
+}
+
+template <typename Node>
+using node_arenas = std::vector<std::unique_ptr<Node[]>>;
+
+// Walks and deletes a detached chain; arena nodes go when their arena is released
+template <typename Node>
+void free_chain(Node *head){
+    while (head != nullptr) {
+        Node *temp = head;
+        head = head->next;
+        if (!temp->in_arena) {
+            delete temp;
+        }
+    }
+}
+
+template <typename Node>
+struct RetiredChain : Retired {
+    Node *head;
+    node_arenas<Node> arenas;
+    RetiredChain(Node *chain, node_arenas<Node> blocks) : head(chain), arenas(std::move(blocks)) {}
+    ~RetiredChain() override {
+        free_chain(head);  // Must finish walking before the arenas are released
+        arenas.clear();
+    }
+};
+
+// On-disk snapshot: this header followed by `count` int32 keys in list order
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+};
+
+static const char SNAPSHOT_MAGIC[4] = {'H', 'L', 'L', 'S'};
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+// StructureLock is any SharedLockable type, e.g. std::shared_mutex or DistributedRWLock;
+// NodeLock is any Lockable type, e.g. std::mutex or AdaptiveSpinLock
+template <typename StructureLock = std::shared_mutex, typename NodeLock = std::mutex>
+class BasicList{
+public:
+    typedef basic_node<NodeLock> node_type;
+    typedef node_arenas<node_type> arenas_type;
+
+private:
+    node_type *head{nullptr};
+    std::atomic<node_type *> tail{nullptr};
+    int size{1000};
+    // Shared for insert/traverse, exclusive only while swapping out the chain
+    StructureLock structure_lock;
+    // Blocks of nodes created by load(), released together with the chain
+    arenas_type arenas;
+
+    // Bumped under the exclusive structure lock by everything that unlinks,
+    // reorders or splices nodes or rewrites jumps; with key_writes (bumped
+    // by for_each when fn changes a key) it tells compact() whether its
+    // copy is still current
+    uint64_t layout_version{0};
+    std::atomic<uint64_t> key_writes{0};
+
+    // Sparse index of every SKIP_INTERVAL-th node, so scans can start
+    // threads mid-list. Extended lazily by parallel scans; dropped by the
+    // operations that unlink or reorder nodes, which hold structure_lock
+    // exclusively and so never race a scan.
+    static const size_t SKIP_INTERVAL = 1024;
+    std::mutex index_lock;
+    std::vector<node_type *> skip_index;
+    node_type *indexed_last{nullptr};
+    size_t indexed_count{0};
+
+    // Jump pointers for software prefetch: each node points prefetch_distance
+    // nodes ahead, so a traversal can prefetch that far in front of itself.
+    // The ring holds the last prefetch_distance appended nodes, whose jumps
+    // are not known yet; only the thread linking a new tail touches it.
+    static const int MAX_PREFETCH_DISTANCE = 64;
+    int prefetch_distance{8};
+    node_type *jump_ring[MAX_PREFETCH_DISTANCE] = {};
+    int jump_pos{0};
+
+    // Caller is the only thread appending (holds the old tail's lock or
+    // structure_lock exclusively)
+    void link_jump(node_type *appended){
+        if (prefetch_distance == 0) {
+            return;
+        }
+        node_type *&slot = jump_ring[jump_pos];
+        if (slot != nullptr) {
+            slot->jump.store(appended, std::memory_order_relaxed);
+        }
+        slot = appended;
+        jump_pos = (jump_pos + 1) % prefetch_distance;
+    }
+
+    // Caller holds structure_lock exclusively
+    void reset_jump_ring(){
+        std::fill(jump_ring, jump_ring + MAX_PREFETCH_DISTANCE, nullptr);
+        jump_pos = 0;
+    }
+
+    // Caller holds structure_lock exclusively
+    void rebuild_jumps(){
+        reset_jump_ring();
+        for (node_type *curr = head; curr != nullptr; curr = curr->next) {
+            curr->jump.store(nullptr, std::memory_order_relaxed);
+            link_jump(curr);
+        }
+    }
+
+    static void prefetch_ahead(const node_type *curr){
+        const node_type *ahead = curr->jump.load(std::memory_order_relaxed);
+        if (ahead != nullptr) {
+            __builtin_prefetch(ahead);
+        }
+    }
+
+    // Caller holds structure_lock exclusively
+    void drop_index(){
+        skip_index.clear();
+        indexed_last = nullptr;
+        indexed_count = 0;
+    }
+
+    // Extends the index to the current tail and returns a copy of it plus
+    // that tail. Caller holds structure_lock shared.
+    node_type *index_snapshot(std::vector<node_type *> &starts){
+        std::lock_guard<std::mutex> guard(index_lock);
+        node_type *end = tail.load(std::memory_order_acquire);
+        if (end == nullptr) {
+            return nullptr;
+        }
+        if (indexed_last != end) {
+            node_type *curr = indexed_last == nullptr ? head : indexed_last->next;
+            while (true) {
+                if (indexed_count % SKIP_INTERVAL == 0) {
+                    skip_index.push_back(curr);
+                }
+                indexed_count++;
+                indexed_last = curr;
+                if (curr == end) {
+                    break;
+                }
+                prefetch_ahead(curr);
+                curr = curr->next;
+            }
+        }
+        starts = skip_index;
+        return end;
+    }
+
+    static int scan_threads(int num_threads){
+        if (num_threads > 0) {
+            return num_threads;
+        }
+        unsigned cpus = std::thread::hardware_concurrency();
+        return cpus ? cpus : 1;
+    }
+
+    // Runs body(first, stop, end, worker) on num_threads workers, each over
+    // a run of whole index intervals; stop is exclusive, or nullptr to run
+    // through end inclusive. Caller holds structure_lock shared.
+    template <typename Body>
+    void split_ranges(int num_threads, Body body){
+        std::vector<node_type *> starts;
+        node_type *end = index_snapshot(starts);
+        if (end == nullptr) {
+            return;
+        }
+        num_threads = scan_threads(num_threads);
+        if ((size_t)num_threads > starts.size()) {
+            num_threads = starts.size();
+        }
+        std::vector<std::thread> workers;
+        for (int t = 0; t < num_threads; t++) {
+            size_t lo = starts.size() * t / num_threads;
+            size_t hi = starts.size() * (t + 1) / num_threads;
+            node_type *first = starts[lo];
+            node_type *stop = hi < starts.size() ? starts[hi] : nullptr;
+            if (t + 1 == num_threads) {
+                body(first, stop, end, t);
+            } else {
+                workers.emplace_back([&body, first, stop, end, t]{ body(first, stop, end, t); });
+            }
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+
+    node_type *detach(arenas_type &blocks){
+        std::unique_lock<StructureLock> guard(structure_lock);
+        node_type *chain = head;
+        head = nullptr;
+        tail.store(nullptr, std::memory_order_relaxed);
+        blocks.swap(arenas);
+        drop_index();
+        reset_jump_ring();
+        layout_version++;
+        return chain;
+    }
+
+    // Merges two sorted chains by relinking; ties keep a's node first
+    static node_type *merge(node_type *a, node_type *b){
+        node_type dummy;
+        node_type *last = &dummy;
+        while (a != nullptr && b != nullptr) {
+            if (b->key < a->key) {
+                last->next = b;
+                b = b->next;
+            } else {
+                last->next = a;
+                a = a->next;
+            }
+            last = last->next;
+        }
+        last->next = (a != nullptr) ? a : b;
+        return dummy.next;
+    }
+
+    // Bottom-up merge sort of a chain; bins[i] holds a sorted run of 2^i nodes
+    static node_type *sort_chain(node_type *chain){
+        node_type *bins[64] = {};
+        int used = 0;
+        while (chain != nullptr) {
+            node_type *run = chain;
+            chain = chain->next;
+            run->next = nullptr;
+            int i = 0;
+            for (; i < used && bins[i] != nullptr; i++) {
+                run = merge(bins[i], run);
+                bins[i] = nullptr;
+            }
+            if (i == used) {
+                used++;
+            }
+            bins[i] = run;
+        }
+        node_type *sorted = nullptr;
+        for (int i = 0; i < used; i++) {
+            sorted = merge(bins[i], sorted);
+        }
+        return sorted;
+    }
+
+public:
+    int insert(int key){
+        node_type *new_node = new node_type;
+        if (new_node == nullptr){
+            return -1;
+        }
+
+        new_node->key = key;
+        new_node->next = nullptr;
+
+        CDS_TIMED(EV_LIST_INSERT);
+        FR_STAMP(wait_start);
+        std::shared_lock<StructureLock> guard(structure_lock);
+        while (true) {
+            node_type *old_tail = tail.load(std::memory_order_acquire);
+
+            // Handle first insertion
+            if (old_tail == nullptr) {
+                guard.unlock();
+                {
+                    std::unique_lock<StructureLock> excl(structure_lock);
+                    if (tail.load(std::memory_order_relaxed) == nullptr) {
+                        head = new_node;
+                        link_jump(new_node);
+                        tail.store(new_node, std::memory_order_release);
+                        FR_RECORD(FR_LIST_INSERT, key, 1, FR_ELAPSED(wait_start));
+                        return 0;
+                    }
+                }
+                guard.lock();
+                continue;
+            }
+
+            // Lock the current tail, retry if someone appended after we read it
+            CDS_LOCK(old_tail->n_lock, EV_NODE_LOCK);
+            if (old_tail->next != nullptr) {
+                old_tail->n_lock.unlock();
+                continue;
+            }
+            FR_RECORD(FR_LIST_INSERT, key, 0, FR_ELAPSED(wait_start));
+            old_tail->next = new_node;
+            // Before publishing the tail, so the next appender can't overlap us
+            link_jump(new_node);
+            tail.store(new_node, std::memory_order_release);
+            old_tail->n_lock.unlock();
+            return 0;
+        }
+    }
+
+
+    void traverse(){
+	    std::shared_lock<StructureLock> guard(structure_lock);
+	    node_type *curr = head;
+	    while (curr != nullptr){
+		prefetch_ahead(curr);
+		CDS_LOCK(curr->n_lock, EV_NODE_LOCK);
+		int key = curr->key;
+		node_type *next = curr->next;
+		curr->n_lock.unlock();
+		LogLine() << key;
+		curr = next;
+	   }
+    }
+
+    // How many nodes ahead traversals prefetch; 0 turns prefetching off.
+    // Rewrites every jump pointer, so it walks the whole list.
+    void set_prefetch_distance(int distance){
+        if (distance < 0 || distance > MAX_PREFETCH_DISTANCE) {
+            throw std::invalid_argument("Prefetch distance out of range");
+        }
+        std::unique_lock<StructureLock> guard(structure_lock);
+        prefetch_distance = distance;
+        rebuild_jumps();
+        layout_version++;
+    }
+
+    // Calls fn(key) on every node in list order with that node locked; fn
+    // may change the key. next is read under the same lock, since insert
+    // writes the tail's next while holding it.
+    template <typename Fn>
+    void for_each(Fn fn){
+        std::shared_lock<StructureLock> guard(structure_lock);
+        node_type *curr = head;
+        while (curr != nullptr) {
+            prefetch_ahead(curr);
+            curr->n_lock.lock();
+            int before = curr->key;
+            fn(curr->key);
+            if (curr->key != before) {
+                key_writes.fetch_add(1, std::memory_order_relaxed);
+            }
+            node_type *next = curr->next;
+            curr->n_lock.unlock();
+            curr = next;
+        }
+    }
+
+    // Like for_each, but the list is split at skip index entries and the
+    // ranges run on num_threads threads (0: one per CPU), so fn must be safe
+    // to call concurrently. Nodes appended after the call starts are skipped.
+    template <typename Fn>
+    void parallel_for_each(Fn fn, int num_threads = 0){
+        std::shared_lock<StructureLock> guard(structure_lock);
+        split_ranges(num_threads, [this, &fn](node_type *first, node_type *stop, node_type *end, int){
+            node_type *curr = first;
+            while (curr != stop) {
+                prefetch_ahead(curr);
+                curr->n_lock.lock();
+                int before = curr->key;
+                fn(curr->key);
+                if (curr->key != before) {
+                    key_writes.fetch_add(1, std::memory_order_relaxed);
+                }
+                node_type *next = curr->next;
+                curr->n_lock.unlock();
+                if (curr == end) {
+                    break;
+                }
+                curr = next;
+            }
+        });
+    }
+
+    // Folds map(key) over the list in parallel; combine must be associative
+    // and identity its neutral element
+    template <typename T, typename Map, typename Combine>
+    T parallel_reduce(T identity, Map map, Combine combine, int num_threads = 0){
+        num_threads = scan_threads(num_threads);
+        std::vector<T> partial(num_threads, identity);
+        std::shared_lock<StructureLock> guard(structure_lock);
+        split_ranges(num_threads, [&](node_type *first, node_type *stop, node_type *end, int worker){
+            T acc = identity;
+            node_type *curr = first;
+            while (curr != stop) {
+                prefetch_ahead(curr);
+                curr->n_lock.lock();
+                int key = curr->key;
+                node_type *next = curr->next;
+                curr->n_lock.unlock();
+                acc = combine(acc, map(key));
+                if (curr == end) {
+                    break;
+                }
+                curr = next;
+            }
+            partial[worker] = acc;
+        });
+        // Workers cover the list in order, so non-commutative folds still work
+        T total = identity;
+        for (const T& value : partial) {
+            total = combine(total, value);
+        }
+        return total;
+    }
+
+    // Read-only lookup; each node is locked while its key is read
+    bool contains(int key){
+        CDS_COUNT(EV_LIST_CONTAINS);
+        std::shared_lock<StructureLock> guard(structure_lock);
+        node_type *curr = head;
+        while (curr != nullptr) {
+            prefetch_ahead(curr);
+            // next is read under the lock too: insert writes the tail's next
+            // while holding it
+            CDS_LOCK(curr->n_lock, EV_NODE_LOCK);
+            bool match = curr->key == key;
+            node_type *next = curr->next;
+            curr->n_lock.unlock();
+            if (match) {
+                FR_RECORD(FR_LIST_CONTAINS, key, 1, 0);
+                return true;
+            }
+            curr = next;
+        }
+        FR_RECORD(FR_LIST_CONTAINS, key, 0, 0);
+        return false;
+    }
+
+    // Stable sort by key in place: the chain is cut into num_threads pieces, each
+    // sorted on its own thread, and the sorted runs are merged pairwise in
+    // parallel. Nodes are relinked, never copied or reallocated. Holds the
+    // structure lock exclusively throughout.
+    void sort(int num_threads = 0){
+        num_threads = scan_threads(num_threads);
+        std::unique_lock<StructureLock> guard(structure_lock);
+        // The sort is stable, so the last of the largest keys becomes the tail
+        size_t count = 0;
+        node_type *last = head;
+        for (node_type *curr = head; curr != nullptr; curr = curr->next) {
+            count++;
+            if (curr->key >= last->key) {
+                last = curr;
+            }
+        }
+        if (count < 2) {
+            return;
+        }
+        if ((size_t)num_threads > count / 1024 + 1) {
+            num_threads = count / 1024 + 1;  // Not worth a thread per handful of nodes
+        }
+
+        // Split by traversal
+        std::vector<node_type *> runs;
+        node_type *curr = head;
+        for (int t = 0; t < num_threads; t++) {
+            size_t piece = count / num_threads + ((size_t)t < count % num_threads ? 1 : 0);
+            runs.push_back(curr);
+            for (size_t i = 1; i < piece; i++) {
+                curr = curr->next;
+            }
+            node_type *next = curr->next;
+            curr->next = nullptr;
+            curr = next;
+        }
+
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < runs.size(); t++) {
+            workers.emplace_back([&runs, t]{ runs[t] = sort_chain(runs[t]); });
+        }
+        runs[0] = sort_chain(runs[0]);
+        for (auto& w : workers) {
+            w.join();
+        }
+
+        while (runs.size() > 1) {
+            std::vector<node_type *> merged((runs.size() + 1) / 2);
+            workers.clear();
+            for (size_t i = 1; i < merged.size(); i++) {
+                workers.emplace_back([&runs, &merged, i]{
+                    merged[i] = (2 * i + 1 < runs.size()) ? merge(runs[2 * i], runs[2 * i + 1]) : runs[2 * i];
+                });
+            }
+            merged[0] = merge(runs[0], runs[1]);
+            for (auto& w : workers) {
+                w.join();
+            }
+            runs.swap(merged);
+        }
+
+        head = runs[0];
+        drop_index();
+        rebuild_jumps();
+        layout_version++;
+        tail.store(last, std::memory_order_release);
+    }
+
+    // Copies the list into one contiguous arena in list order and swaps it
+    // in, restoring traversal locality after churn. The copy runs under the
+    // shared structure lock, so readers and appenders carry on; the
+    // exclusive lock is only held to splice in the copy, and the old nodes
+    // go to the background reclaimer. Nodes appended during the copy stay
+    // where they are. If something reorders the list or writes a key while
+    // the copy runs, it is retried. Returns the number of nodes relocated,
+    // or -1 after max_attempts.
+    long long compact(int max_attempts = 3){
+        for (int attempt = 0; attempt < max_attempts; attempt++) {
+            uint64_t version;
+            uint64_t writes = key_writes.load(std::memory_order_acquire);
+            node_type *end;
+            size_t count = 0;
+            std::unique_ptr<node_type[]> arena;
+            {
+                std::shared_lock<StructureLock> guard(structure_lock);
+                version = layout_version;
+                end = tail.load(std::memory_order_acquire);
+                if (end == nullptr) {
+                    return 0;
+                }
+                for (node_type *curr = head; ; curr = curr->next) {
+                    count++;
+                    if (curr == end) {
+                        break;
+                    }
+                }
+                arena.reset(new node_type[count]);
+                size_t i = 0;
+                for (node_type *curr = head; ; curr = curr->next, i++) {
+                    prefetch_ahead(curr);
+                    curr->n_lock.lock();
+                    arena[i].key = curr->key;
+                    curr->n_lock.unlock();
+                    arena[i].in_arena = true;
+                    arena[i].next = (i + 1 < count) ? &arena[i + 1] : nullptr;
+                    if (prefetch_distance > 0 && i + prefetch_distance < count) {
+                        arena[i].jump.store(&arena[i + prefetch_distance], std::memory_order_relaxed);
+                    }
+                    if (curr == end) {
+                        break;
+                    }
+                }
+            }
+
+            arenas_type old_arenas;
+            node_type *old_chain;
+            {
+                std::unique_lock<StructureLock> guard(structure_lock);
+                if (layout_version != version || key_writes.load(std::memory_order_acquire) != writes) {
+                    continue;
+                }
+                // Carry over anything appended since the copy
+                arena[count - 1].next = end->next;
+                end->next = nullptr;
+                if (tail.load(std::memory_order_relaxed) == end) {
+                    tail.store(&arena[count - 1], std::memory_order_release);
+                }
+                node_type *copy = arena.get();
+                old_chain = head;
+                head = copy;
+                old_arenas.swap(arenas);
+                arenas.push_back(std::move(arena));
+                drop_index();
+                // Arena jumps are already set; refill the ring from the
+                // copy's last nodes and walk only what was appended
+                reset_jump_ring();
+                if (prefetch_distance > 0) {
+                    size_t ring_start = count > (size_t)prefetch_distance ? count - prefetch_distance : 0;
+                    for (node_type *curr = &copy[ring_start]; curr != nullptr; curr = curr->next) {
+                        link_jump(curr);
+                    }
+                }
+                layout_version++;
+            }
+            background_reclaimer().retire(std::make_unique<RetiredChain<node_type>>(old_chain, std::move(old_arenas)));
+            return count;
+        }
+        return -1;
+    }
+
+    bool is_sorted(){
+        std::shared_lock<StructureLock> guard(structure_lock);
+        node_type *curr = head;
+        bool first = true;
+        int prev_key = 0;
+        while (curr != nullptr) {
+            // Key and next under the node lock, like contains() and for_each()
+            curr->n_lock.lock();
+            int key = curr->key;
+            node_type *next = curr->next;
+            curr->n_lock.unlock();
+            if (!first && key < prev_key) {
+                return false;
+            }
+            first = false;
+            prev_key = key;
+            curr = next;
+        }
+        return true;
+    }
+
+    // Removes the first node into key, returning false if the list is empty.
+    // Takes the structure lock exclusively since an appender may be linking
+    // onto that same node.
+    bool pop_front(int &key){
+        node_type *first;
+        {
+            std::unique_lock<StructureLock> guard(structure_lock);
+            first = head;
+            if (first == nullptr) {
+                return false;
+            }
+            head = first->next;
+            drop_index();
+            layout_version++;
+            // Only the last prefetch_distance nodes can still be in the ring
+            std::replace(jump_ring, jump_ring + MAX_PREFETCH_DISTANCE, first, (node_type *)nullptr);
+            if (head == nullptr) {
+                tail.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+        key = first->key;
+        if (!first->in_arena) {
+            delete first;
+        }
+        return true;
+    }
+
+    // O(1) on the calling thread: the chain is detached and freed by the reclaimer
+    void clear(){
+        arenas_type blocks;
+        FR_STAMP(wait_start);
+        node_type *chain = detach(blocks);
+        FR_RECORD(FR_LIST_CLEAR, 0, chain != nullptr, FR_ELAPSED(wait_start));
+        if (chain != nullptr || !blocks.empty()) {
+            background_reclaimer().retire(std::make_unique<RetiredChain<node_type>>(chain, std::move(blocks)));
+        }
+    }
+
+    // Frees the chain inline, for callers that need the memory back immediately
+    void clear_now(){
+        arenas_type blocks;
+        node_type *chain = detach(blocks);
+        RetiredChain<node_type> retired(chain, std::move(blocks));
+    }
+
+    // Writes the keys currently in the list to path; concurrent inserts past
+    // the tail seen at the start are not included
+    int save(const char *path){
+        std::FILE *out = std::fopen(path, "wb");
+        if (out == nullptr) {
+            return -1;
+        }
+
+        SnapshotHeader header;
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.count = 0;
+        bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+
+        {
+            std::shared_lock<StructureLock> guard(structure_lock);
+            node_type *last = tail.load(std::memory_order_acquire);
+            std::vector<int32_t> buffer;
+            buffer.reserve(4096);
+            for (node_type *curr = head; ok && curr != nullptr; curr = curr->next) {
+                // for_each may be rewriting keys under the node lock
+                curr->n_lock.lock();
+                buffer.push_back(curr->key);
+                curr->n_lock.unlock();
+                header.count++;
+                if (buffer.size() == buffer.capacity() || curr == last) {
+                    ok = std::fwrite(buffer.data(), sizeof(int32_t), buffer.size(), out) == buffer.size();
+                    buffer.clear();
+                }
+                if (curr == last) {
+                    break;
+                }
+            }
+        }
+
+        // Patch in the real count now that we know it
+        ok = ok && std::fseek(out, 0, SEEK_SET) == 0
+                && std::fwrite(&header, sizeof(header), 1, out) == 1;
+        ok = (std::fclose(out) == 0) && ok;
+        return ok ? 0 : -1;
+    }
+
+    // Maps a snapshot written by save() and appends its keys. All nodes come
+    // from one arena allocation and are linked in a single pass.
+    int load(const char *path){
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return -1;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+            close(fd);
+            return -1;
+        }
+        void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            return -1;
+        }
+        madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+
+        const SnapshotHeader *header = static_cast<const SnapshotHeader *>(mapped);
+        uint64_t count = header->count;
+        if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0
+            || header->version != SNAPSHOT_VERSION
+            || count > ((size_t)st.st_size - sizeof(SnapshotHeader)) / sizeof(int32_t)) {
+            munmap(mapped, st.st_size);
+            return -1;
+        }
+        if (count == 0) {
+            munmap(mapped, st.st_size);
+            return 0;
+        }
+
+        const int32_t *keys = reinterpret_cast<const int32_t *>(header + 1);
+        std::unique_ptr<node_type[]> arena(new node_type[count]);
+        for (uint64_t i = 0; i < count; i++) {
+            arena[i].key = keys[i];
+            arena[i].in_arena = true;
+            arena[i].next = (i + 1 < count) ? &arena[i + 1] : nullptr;
+        }
+        munmap(mapped, st.st_size);
+
+        // Splice the new chain onto the end
+        std::unique_lock<StructureLock> guard(structure_lock);
+        node_type *old_tail = tail.load(std::memory_order_relaxed);
+        if (old_tail == nullptr) {
+            head = &arena[0];
+        } else {
+            old_tail->n_lock.lock();
+            old_tail->next = &arena[0];
+            old_tail->n_lock.unlock();
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            link_jump(&arena[i]);
+        }
+        layout_version++;
+        tail.store(&arena[count - 1], std::memory_order_release);
+        arenas.push_back(std::move(arena));
+        return 0;
+    }
+
+    // Touches the reclaimer so it finishes construction first. Function-local
+    // statics are destroyed in reverse order, so even a List with static
+    // storage duration is destroyed, and retires its nodes, before it.
+    BasicList() {
+        background_reclaimer();
+    }
+
+    ~BasicList() {
+        clear();
+    }
+};
+
+typedef BasicList<> List;
+
+// Link and lock fields for IntrusiveList, embedded by the element type:
+//     struct Order : list_hook { int id; ... };
+template <typename NodeLock = std::mutex>
+struct basic_list_hook{
+    basic_list_hook * next{nullptr};
+    NodeLock n_lock{};
+};
+
+typedef basic_list_hook<> list_hook;
+
+// Same append protocol as BasicList, but over caller-owned objects that
+// derive from basic_list_hook, so insert and remove never allocate. The list
+// never frees elements; an element must stay alive until it is removed or
+// the list is cleared, and can be in only one IntrusiveList at a time.
+template <typename T, typename StructureLock = std::shared_mutex, typename NodeLock = std::mutex>
+class IntrusiveList{
+public:
+    typedef basic_list_hook<NodeLock> hook_type;
+
+private:
+    hook_type *head{nullptr};
+    std::atomic<hook_type *> tail{nullptr};
+    StructureLock structure_lock;
+
+    // Caller holds structure_lock exclusively
+    void unlink(hook_type *prev, hook_type *item){
+        if (prev == nullptr) {
+            head = item->next;
+        } else {
+            prev->next = item->next;
+        }
+        if (tail.load(std::memory_order_relaxed) == item) {
+            tail.store(prev, std::memory_order_relaxed);
+        }
+        item->next = nullptr;
+    }
+
+public:
+    void insert(T *item){
+        hook_type *new_node = item;
+        new_node->next = nullptr;
+
+        std::shared_lock<StructureLock> guard(structure_lock);
+        while (true) {
+            hook_type *old_tail = tail.load(std::memory_order_acquire);
+
+            if (old_tail == nullptr) {
+                guard.unlock();
+                {
+                    std::unique_lock<StructureLock> excl(structure_lock);
+                    if (tail.load(std::memory_order_relaxed) == nullptr) {
+                        head = new_node;
+                        tail.store(new_node, std::memory_order_release);
+                        return;
+                    }
+                }
+                guard.lock();
+                continue;
+            }
+
+            old_tail->n_lock.lock();
+            if (old_tail->next != nullptr) {
+                old_tail->n_lock.unlock();
+                continue;
+            }
+            old_tail->next = new_node;
+            tail.store(new_node, std::memory_order_release);
+            old_tail->n_lock.unlock();
+            return;
+        }
+    }
+
+    // Unlinks item if it is in the list; O(position) since links are singly linked
+    bool remove(T *item){
+        hook_type *target = item;
+        std::unique_lock<StructureLock> guard(structure_lock);
+        hook_type *prev = nullptr;
+        for (hook_type *curr = head; curr != nullptr; prev = curr, curr = curr->next) {
+            if (curr == target) {
+                unlink(prev, curr);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Unlinks and returns the first element, or nullptr if the list is empty
+    T *pop_front(){
+        std::unique_lock<StructureLock> guard(structure_lock);
+        hook_type *first = head;
+        if (first == nullptr) {
+            return nullptr;
+        }
+        unlink(nullptr, first);
+        return static_cast<T *>(first);
+    }
+
+    bool contains(const T *item){
+        const hook_type *target = item;
+        std::shared_lock<StructureLock> guard(structure_lock);
+        hook_type *curr = head;
+        while (curr != nullptr) {
+            if (curr == target) {
+                return true;
+            }
+            // insert writes the tail's next under its lock
+            curr->n_lock.lock();
+            hook_type *next = curr->next;
+            curr->n_lock.unlock();
+            curr = next;
+        }
+        return false;
+    }
+
+    // Forgets every element without touching them; the caller still owns them
+    void clear(){
+        std::unique_lock<StructureLock> guard(structure_lock);
+        head = nullptr;
+        tail.store(nullptr, std::memory_order_relaxed);
+    }
+};
+
+#endif // HAND_LOCK_LL_H
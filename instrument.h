@@ -0,0 +1,183 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+// Aggregate counts, latencies and lock contention for hot paths. Build with
+// -DCDS_INSTRUMENT=1 to collect; otherwise every hook below is an empty inline
+// function (or a plain lock()) and compiles to exactly the uninstrumented code.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef CDS_INSTRUMENT
+#define CDS_INSTRUMENT 0
+#endif
+
+enum InstrumentEvent {
+    EV_COUNTER_INCREMENT,
+    EV_SHARED_INCREMENT,
+    EV_LIST_INSERT,
+    EV_LIST_CONTAINS,
+    EV_NODE_LOCK,
+    EV_COUNT
+};
+
+inline const char *instrument_event_name(InstrumentEvent event) {
+    static const char *names[EV_COUNT] = {
+        "counter_increment", "shared_increment", "list_insert", "list_contains", "node_lock",
+    };
+    return names[event];
+}
+
+template <bool Enabled>
+struct Instrumentation;
+
+template <>
+struct Instrumentation<false> {
+    static const bool enabled = false;
+
+    static void count(InstrumentEvent) {}
+
+    template <typename Lock>
+    static void lock(Lock& l, InstrumentEvent) { l.lock(); }
+
+    struct Timer {
+        explicit Timer(InstrumentEvent) {}
+    };
+
+    static void report(std::ostream&) {}
+    static void report_at_exit() {}
+};
+
+template <>
+struct Instrumentation<true> {
+    static const bool enabled = true;
+
+    // Written only by the owning thread (load + store, no RMW); read by report()
+    struct ThreadStats {
+        std::atomic<uint64_t> events[EV_COUNT];
+        std::atomic<uint64_t> nanos[EV_COUNT];
+        std::atomic<uint64_t> contended[EV_COUNT];
+        std::atomic<uint64_t> wait_nanos[EV_COUNT];
+
+        ThreadStats() {
+            for (int i = 0; i < EV_COUNT; i++) {
+                events[i].store(0, std::memory_order_relaxed);
+                nanos[i].store(0, std::memory_order_relaxed);
+                contended[i].store(0, std::memory_order_relaxed);
+                wait_nanos[i].store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct Registry {
+        std::mutex lock;
+        std::vector<std::shared_ptr<ThreadStats>> threads;  // Outlive their threads
+    };
+
+    static Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    static ThreadStats& local() {
+        thread_local std::shared_ptr<ThreadStats> stats = [] {
+            auto created = std::make_shared<ThreadStats>();
+            std::lock_guard<std::mutex> guard(registry().lock);
+            registry().threads.push_back(created);
+            return created;
+        }();
+        return *stats;
+    }
+
+    static void bump(std::atomic<uint64_t>& field, uint64_t n) {
+        field.store(field.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static uint64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void count(InstrumentEvent event) {
+        bump(local().events[event], 1);
+    }
+
+    // Counts the acquisition and, if try_lock fails, how long the wait took
+    template <typename Lock>
+    static void lock(Lock& l, InstrumentEvent event) {
+        ThreadStats& stats = local();
+        bump(stats.events[event], 1);
+        if (l.try_lock()) {
+            return;
+        }
+        uint64_t start = now_ns();
+        l.lock();
+        bump(stats.contended[event], 1);
+        bump(stats.wait_nanos[event], now_ns() - start);
+    }
+
+    struct Timer {
+        InstrumentEvent event;
+        uint64_t start;
+        explicit Timer(InstrumentEvent e) : event(e), start(now_ns()) {}
+        ~Timer() {
+            ThreadStats& stats = local();
+            bump(stats.events[event], 1);
+            bump(stats.nanos[event], now_ns() - start);
+        }
+    };
+
+    static void report(std::ostream& out) {
+        uint64_t events[EV_COUNT] = {}, nanos[EV_COUNT] = {}, contended[EV_COUNT] = {}, wait[EV_COUNT] = {};
+        {
+            std::lock_guard<std::mutex> guard(registry().lock);
+            for (auto& stats : registry().threads) {
+                for (int i = 0; i < EV_COUNT; i++) {
+                    events[i] += stats->events[i].load(std::memory_order_relaxed);
+                    nanos[i] += stats->nanos[i].load(std::memory_order_relaxed);
+                    contended[i] += stats->contended[i].load(std::memory_order_relaxed);
+                    wait[i] += stats->wait_nanos[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+        out << "\n=== Instrumentation ===" << std::endl;
+        for (int i = 0; i < EV_COUNT; i++) {
+            if (events[i] == 0) {
+                continue;
+            }
+            out << instrument_event_name((InstrumentEvent)i) << ": " << events[i] << " events";
+            if (nanos[i]) {
+                out << ", " << nanos[i] / events[i] << " ns avg";
+            }
+            if (contended[i]) {
+                out << ", " << contended[i] << " contended, " << wait[i] / contended[i] << " ns avg wait";
+            }
+            out << std::endl;
+        }
+    }
+
+    static void report_at_exit() {
+        registry();  // Constructed first so it is destroyed after the handler runs
+        std::atexit([] { report(std::cout); });
+    }
+};
+
+typedef Instrumentation<CDS_INSTRUMENT != 0> Instrument;
+
+#define CDS_INSTRUMENT_CONCAT_(a, b) a##b
+#define CDS_INSTRUMENT_CONCAT(a, b) CDS_INSTRUMENT_CONCAT_(a, b)
+
+// Counts one occurrence of event
+#define CDS_COUNT(event) Instrument::count(event)
+// Times the rest of the enclosing scope
+#define CDS_TIMED(event) Instrument::Timer CDS_INSTRUMENT_CONCAT(cds_timer_, __LINE__)(event)
+// lockable.lock(), counting contended acquisitions and their wait
+#define CDS_LOCK(lockable, event) Instrument::lock((lockable), (event))
+
+#endif // INSTRUMENT_H
@@ -0,0 +1,215 @@
+#ifndef LOCKS_H
+#define LOCKS_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Small dense id per thread, handed out on first use
+inline int lock_thread_index() {
+    static std::atomic<int> next_index{0};
+    thread_local int index = next_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+// Big-reader lock built on the same per-thread slot idea as
+// ApproximateConcurrentCounter: each reader only touches its own padded
+// indicator, so read acquisitions from different threads never share a
+// cache line. A writer raises a flag and waits for every indicator to drain,
+// which makes writes O(slots). Meets SharedLockable, so it works with
+// std::shared_lock and std::unique_lock.
+class DistributedRWLock {
+private:
+    struct alignas(64) ReaderSlot {
+        std::atomic<int> readers{0};
+    };
+
+    std::unique_ptr<ReaderSlot[]> slots;
+    int num_slots;
+    alignas(64) std::atomic<bool> writer{false};
+
+    ReaderSlot& my_slot() {
+        return slots[lock_thread_index() % num_slots];
+    }
+
+    static void wait_a_bit(int& spins) {
+        if (++spins < 64) {
+            cpu_relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+public:
+    // Threads beyond `reader_slots` share slots, which stays correct but contends
+    explicit DistributedRWLock(int reader_slots = 64) : num_slots(reader_slots) {
+        slots.reset(new ReaderSlot[num_slots]);
+    }
+
+    void lock_shared() {
+        ReaderSlot& slot = my_slot();
+        int spins = 0;
+        while (true) {
+            slot.readers.fetch_add(1, std::memory_order_seq_cst);
+            if (!writer.load(std::memory_order_seq_cst)) {
+                return;
+            }
+            // A writer is active or waiting: back out so it can drain
+            slot.readers.fetch_sub(1, std::memory_order_release);
+            while (writer.load(std::memory_order_relaxed)) {
+                wait_a_bit(spins);
+            }
+        }
+    }
+
+    bool try_lock_shared() {
+        ReaderSlot& slot = my_slot();
+        slot.readers.fetch_add(1, std::memory_order_seq_cst);
+        if (!writer.load(std::memory_order_seq_cst)) {
+            return true;
+        }
+        slot.readers.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    void unlock_shared() {
+        my_slot().readers.fetch_sub(1, std::memory_order_release);
+    }
+
+    void lock() {
+        int spins = 0;
+        bool expected = false;
+        while (!writer.compare_exchange_weak(expected, true, std::memory_order_seq_cst)) {
+            expected = false;
+            wait_a_bit(spins);
+        }
+        for (int i = 0; i < num_slots; i++) {
+            while (slots[i].readers.load(std::memory_order_seq_cst) != 0) {
+                wait_a_bit(spins);
+            }
+        }
+    }
+
+    bool try_lock() {
+        bool expected = false;
+        if (!writer.compare_exchange_strong(expected, true, std::memory_order_seq_cst)) {
+            return false;
+        }
+        for (int i = 0; i < num_slots; i++) {
+            if (slots[i].readers.load(std::memory_order_seq_cst) != 0) {
+                writer.store(false, std::memory_order_release);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void unlock() {
+        writer.store(false, std::memory_order_release);
+    }
+};
+
+// Blocks until *word != expected (or a spurious wakeup); callers re-check
+inline void futex_wait(std::atomic<int> *word, int expected) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<int *>(word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    if (word->load(std::memory_order_relaxed) == expected) {
+        std::this_thread::yield();
+    }
+#endif
+}
+
+inline void futex_wake_one(std::atomic<int> *word) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<int *>(word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+// Spin-then-park mutex. Contended acquires spin with exponential backoff
+// (pause between attempts) for up to a budget that tunes itself from how
+// long recent acquisitions took, then park on a futex. When the owner tends
+// to be preempted the spins keep failing and the budget shrinks, so waiters
+// go to sleep quickly instead of burning their time slice.
+class AdaptiveSpinLock {
+private:
+    static const int MIN_SPIN = 16;
+    static const int MAX_SPIN = 8192;
+    static const int MAX_BACKOFF = 64;
+
+    std::atomic<int> state{0};          // 0 free, 1 held, 2 held with sleepers
+    std::atomic<int> spin_budget{128};  // Pause iterations before parking
+
+    bool try_acquire() {
+        int expected = 0;
+        return state.load(std::memory_order_relaxed) == 0
+            && state.compare_exchange_strong(expected, 1, std::memory_order_acquire);
+    }
+
+public:
+    void lock() {
+        if (try_acquire()) {
+            return;
+        }
+
+        int budget = spin_budget.load(std::memory_order_relaxed);
+        int limit = budget * 2 < MAX_SPIN ? budget * 2 : MAX_SPIN;
+        int spent = 0;
+        int backoff = 1;
+        while (spent < limit) {
+            for (int i = 0; i < backoff; i++) {
+                cpu_relax();
+            }
+            spent += backoff;
+            backoff = backoff * 2 < MAX_BACKOFF ? backoff * 2 : MAX_BACKOFF;
+            if (try_acquire()) {
+                // Move the budget an eighth of the way towards what this acquire needed
+                int tuned = budget + (spent - budget) / 8;
+                spin_budget.store(tuned > MIN_SPIN ? tuned : MIN_SPIN, std::memory_order_relaxed);
+                return;
+            }
+        }
+        int shrunk = budget / 2;
+        spin_budget.store(shrunk > MIN_SPIN ? shrunk : MIN_SPIN, std::memory_order_relaxed);
+
+        // Park: mark the lock contended so unlock() knows to wake someone
+        int c = state.exchange(2, std::memory_order_acquire);
+        while (c != 0) {
+            futex_wait(&state, 2);
+            c = state.exchange(2, std::memory_order_acquire);
+        }
+    }
+
+    bool try_lock() {
+        int expected = 0;
+        return state.compare_exchange_strong(expected, 1, std::memory_order_acquire);
+    }
+
+    void unlock() {
+        if (state.exchange(0, std::memory_order_release) == 2) {
+            futex_wake_one(&state);
+        }
+    }
+};
+
+#endif // LOCKS_H
@@ -0,0 +1,156 @@
+#ifndef MCAS_H
+#define MCAS_H
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+// Lock-free multi-word compare-and-swap (Harris, Fraser & Pratt, "A Practical
+// Multi-Word Compare-and-Swap Operation"). Each target word temporarily
+// holds a pointer to the operation's descriptor; any thread that reads one
+// helps the operation finish instead of waiting, so no thread can block
+// another. Words taking part must be mcas_word and read with mcas_read().
+// Their values must keep the low two bits clear (aligned pointers, or
+// integers shifted left); bit 2 and up are free for the caller.
+//
+// Descriptors may still be read by helpers after mcas() returns, so callers
+// free them through an EpochReclaimer (see McasList).
+
+typedef std::atomic<uintptr_t> mcas_word;
+
+static const uintptr_t MCAS_RDCSS_TAG = 1;  // Word holds an RdcssDescriptor
+static const uintptr_t MCAS_DESC_TAG = 2;   // Word holds an McasDescriptor
+static const uintptr_t MCAS_TAGS = MCAS_RDCSS_TAG | MCAS_DESC_TAG;
+static const int MCAS_MAX_WORDS = 4;
+
+enum McasStatus : int { MCAS_UNDECIDED, MCAS_SUCCEEDED, MCAS_FAILED };
+
+struct McasDescriptor;
+
+// Installs the McasDescriptor into word `index` only while the operation is
+// still undecided, so a late helper can't resurrect a finished operation
+struct alignas(8) RdcssDescriptor {
+    McasDescriptor *owner;
+    int index;
+};
+
+struct alignas(8) McasDescriptor {
+    std::atomic<int> status{MCAS_UNDECIDED};
+    int count{0};
+    mcas_word *addr[MCAS_MAX_WORDS];
+    uintptr_t expected[MCAS_MAX_WORDS];
+    uintptr_t desired[MCAS_MAX_WORDS];
+    RdcssDescriptor rdcss[MCAS_MAX_WORDS];
+
+    // Words are kept in address order so that competing operations acquire
+    // them in the same order and always make progress. Passing the same
+    // value as expected and desired just checks the word.
+    void add(mcas_word& word, uintptr_t expect, uintptr_t desire) {
+        if (count == MCAS_MAX_WORDS) {
+            throw std::invalid_argument("Too many words for one mcas");
+        }
+        if ((expect | desire) & MCAS_TAGS) {
+            throw std::invalid_argument("mcas values must have the low two bits clear");
+        }
+        int i = count;
+        while (i > 0 && addr[i - 1] > &word) {
+            addr[i] = addr[i - 1];
+            expected[i] = expected[i - 1];
+            desired[i] = desired[i - 1];
+            i--;
+        }
+        if (i > 0 && addr[i - 1] == &word) {
+            throw std::invalid_argument("Word added twice to one mcas");
+        }
+        addr[i] = &word;
+        expected[i] = expect;
+        desired[i] = desire;
+        count++;
+        for (int j = 0; j < count; j++) {
+            rdcss[j].owner = this;
+            rdcss[j].index = j;
+        }
+    }
+};
+
+inline bool mcas_is_rdcss(uintptr_t value) { return value & MCAS_RDCSS_TAG; }
+inline bool mcas_is_descriptor(uintptr_t value) { return value & MCAS_DESC_TAG; }
+
+inline void rdcss_complete(RdcssDescriptor *d) {
+    McasDescriptor *cd = d->owner;
+    uintptr_t self = (uintptr_t)d | MCAS_RDCSS_TAG;
+    uintptr_t replacement = cd->status.load(std::memory_order_acquire) == MCAS_UNDECIDED
+        ? (uintptr_t)cd | MCAS_DESC_TAG
+        : cd->expected[d->index];
+    cd->addr[d->index]->compare_exchange_strong(self, replacement, std::memory_order_acq_rel);
+}
+
+// Returns the value the word held: expected[index] if the install went through
+inline uintptr_t rdcss(RdcssDescriptor *d) {
+    McasDescriptor *cd = d->owner;
+    uintptr_t tagged = (uintptr_t)d | MCAS_RDCSS_TAG;
+    while (true) {
+        uintptr_t current = cd->expected[d->index];
+        if (cd->addr[d->index]->compare_exchange_strong(current, tagged, std::memory_order_acq_rel)) {
+            rdcss_complete(d);
+            return cd->expected[d->index];
+        }
+        if (!mcas_is_rdcss(current)) {
+            return current;
+        }
+        rdcss_complete((RdcssDescriptor *)(current & ~MCAS_TAGS));
+    }
+}
+
+inline bool mcas_help(McasDescriptor *cd) {
+    uintptr_t self = (uintptr_t)cd | MCAS_DESC_TAG;
+    if (cd->status.load(std::memory_order_acquire) == MCAS_UNDECIDED) {
+        // Phase 1: claim every word or find one that doesn't match
+        int outcome = MCAS_SUCCEEDED;
+        for (int i = 0; i < cd->count && outcome == MCAS_SUCCEEDED; i++) {
+            while (true) {
+                uintptr_t seen = rdcss(&cd->rdcss[i]);
+                if (mcas_is_descriptor(seen) && seen != self) {
+                    mcas_help((McasDescriptor *)(seen & ~MCAS_TAGS));
+                    continue;
+                }
+                if (seen != self && seen != cd->expected[i]) {
+                    outcome = MCAS_FAILED;
+                }
+                break;
+            }
+        }
+        int undecided = MCAS_UNDECIDED;
+        cd->status.compare_exchange_strong(undecided, outcome, std::memory_order_acq_rel);
+    }
+
+    // Phase 2: replace the descriptor with the new (or restored) values
+    bool succeeded = cd->status.load(std::memory_order_acquire) == MCAS_SUCCEEDED;
+    for (int i = 0; i < cd->count; i++) {
+        uintptr_t current = self;
+        cd->addr[i]->compare_exchange_strong(current, succeeded ? cd->desired[i] : cd->expected[i],
+                                             std::memory_order_acq_rel);
+    }
+    return succeeded;
+}
+
+// Atomically: if every word holds its expected value, store all desired values
+inline bool mcas(McasDescriptor *cd) {
+    return mcas_help(cd);
+}
+
+// Reads the logical value of a word, finishing any operation in flight on it
+inline uintptr_t mcas_read(mcas_word& word) {
+    while (true) {
+        uintptr_t value = word.load(std::memory_order_acquire);
+        if (mcas_is_rdcss(value)) {
+            rdcss_complete((RdcssDescriptor *)(value & ~MCAS_TAGS));
+        } else if (mcas_is_descriptor(value)) {
+            mcas_help((McasDescriptor *)(value & ~MCAS_TAGS));
+        } else {
+            return value;
+        }
+    }
+}
+
+#endif // MCAS_H
@@ -0,0 +1,97 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <random>
+#include "mcas_list.h"
+
+// Pending/active workload: keys bounce between two sets while other threads
+// try to register new keys in either. Every key must end up in exactly one set.
+
+static const int KEY_RANGE = 512;
+
+template <typename Set, typename MoveFn, typename InsertFn>
+long long time_moves(Set& pending, Set& active, int num_threads, int ops, MoveFn move_fn, InsertFn insert_fn,
+                     long long& moved) {
+    std::atomic<long long> total{0};
+    std::vector<std::thread> threads;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng(t + 1);
+            long long local = 0;
+            for (int i = 0; i < ops; i++) {
+                int key = rng() % KEY_RANGE;
+                if (i % 8 == 0) {
+                    insert_fn(key, t);
+                } else if (rng() & 1) {
+                    local += move_fn(pending, active, key, t);
+                } else {
+                    local += move_fn(active, pending, key, t);
+                }
+            }
+            total.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    moved = total.load();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+}
+
+// Every key in exactly one of the two sets
+template <typename Set>
+bool disjoint(Set& pending, Set& active) {
+    for (int key = 0; key < KEY_RANGE; key++) {
+        if (pending.contains(key, 0) && active.contains(key, 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int total_ops = argc > 1 ? std::stoi(argv[1]) : 2000000;
+
+    std::cout << "=== Move between two sets (" << total_ops << " ops split across threads, "
+              << KEY_RANGE << " keys) ===" << std::endl;
+    for (int num_threads = 1; num_threads <= 16; num_threads *= 4) {
+        int ops = total_ops / num_threads;
+        long long mcas_moved, locked_moved;
+        long long mcas_ms, locked_ms;
+        bool mcas_ok, locked_ok;
+        {
+            EpochReclaimer reclaimer(num_threads);
+            McasList pending(reclaimer), active(reclaimer);
+            for (int key = 0; key < KEY_RANGE; key += 2) {
+                pending.insert(key, 0);
+            }
+            mcas_ms = time_moves(pending, active, num_threads, ops,
+                [](McasList& from, McasList& to, int key, int id) { return mcas_move(from, to, key, id); },
+                [&](int key, int id) { mcas_insert_if_absent_in_both(pending, active, key, id); },
+                mcas_moved);
+            mcas_ok = disjoint(pending, active);
+        }
+        {
+            EpochReclaimer reclaimer(num_threads);
+            LockedSortedList pending(reclaimer), active(reclaimer);
+            for (int key = 0; key < KEY_RANGE; key += 2) {
+                pending.insert(key, 0);
+            }
+            locked_ms = time_moves(pending, active, num_threads, ops,
+                [](LockedSortedList& from, LockedSortedList& to, int key, int id) {
+                    return locked_move(from, to, key, id);
+                },
+                [&](int key, int id) { locked_insert_if_absent_in_both(pending, active, key, id); },
+                locked_moved);
+            locked_ok = disjoint(pending, active);
+        }
+        std::cout << num_threads << " thread(s): mcas " << mcas_ms << " ms (" << mcas_moved << " moves"
+                  << (mcas_ok ? "" : ", KEY IN BOTH SETS") << "), two-list locking " << locked_ms << " ms ("
+                  << locked_moved << " moves" << (locked_ok ? "" : ", KEY IN BOTH SETS") << ")" << std::endl;
+    }
+    return 0;
+}
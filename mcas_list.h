@@ -0,0 +1,381 @@
+#ifndef MCAS_LIST_H
+#define MCAS_LIST_H
+
+#include <atomic>
+#include <climits>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include "mcas.h"
+#include "epoch_reclaim.h"
+
+// Sorted set of ints whose links are mcas words, so an update spanning two
+// lists (move, insert-if-absent-in-both) is one multi-word CAS with no lock.
+// A delete unlinks the node and marks its own next pointer in the same mcas,
+// so a concurrent insert after that node fails its expected value and retries.
+// Lists that are used together must share one EpochReclaimer; nodes and
+// descriptors are retired through it, so every call takes a dense thread id.
+
+static const uintptr_t MCAS_LIST_MARK = 4;  // Set in a deleted node's next word
+
+struct McasNode {
+    int key;
+    mcas_word next{0};
+};
+
+class McasList {
+private:
+    McasNode head;  // Sentinel, never removed
+    EpochReclaimer& reclaimer;
+
+    static McasNode *node_of(uintptr_t word) {
+        return (McasNode *)(word & ~MCAS_LIST_MARK);
+    }
+
+    static bool is_marked(uintptr_t word) {
+        return word & MCAS_LIST_MARK;
+    }
+
+    // pred is the last node with key < key, curr the first with key >= key
+    // (nullptr at the end). Marked links are followed through; any mcas that
+    // builds on a deleted pred or curr fails its expected values.
+    void find(int key, McasNode *&pred, McasNode *&curr) {
+        pred = &head;
+        curr = node_of(mcas_read(head.next));
+        while (curr != nullptr && curr->key < key) {
+            pred = curr;
+            curr = node_of(mcas_read(curr->next));
+        }
+    }
+
+    // Runs a filled-in descriptor and retires it
+    bool run(McasDescriptor *d, int thread_id) {
+        bool ok = mcas(d);
+        reclaimer.retire(thread_id, d);
+        return ok;
+    }
+
+    friend bool mcas_move(McasList& from, McasList& to, int key, int thread_id);
+    friend bool mcas_insert_if_absent_in_both(McasList& into, McasList& other, int key, int thread_id);
+
+public:
+    McasList(EpochReclaimer& r) : reclaimer(r) {
+        head.key = INT_MIN;
+    }
+
+    McasList(const McasList&) = delete;
+    McasList& operator=(const McasList&) = delete;
+
+    bool insert(int key, int thread_id) {
+        EpochGuard guard(reclaimer, thread_id);
+        McasNode *created = new McasNode;
+        created->key = key;
+        while (true) {
+            McasNode *pred, *curr;
+            find(key, pred, curr);
+            if (curr != nullptr && curr->key == key) {
+                if (is_marked(mcas_read(curr->next))) {
+                    continue;  // Being deleted; look again
+                }
+                delete created;
+                return false;
+            }
+            created->next.store((uintptr_t)curr, std::memory_order_relaxed);
+            // One word, so a plain CAS is enough; it fails if a descriptor is installed
+            uintptr_t expected = (uintptr_t)curr;
+            if (pred->next.compare_exchange_strong(expected, (uintptr_t)created, std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+    }
+
+    bool remove(int key, int thread_id) {
+        EpochGuard guard(reclaimer, thread_id);
+        while (true) {
+            McasNode *pred, *curr;
+            find(key, pred, curr);
+            if (curr == nullptr || curr->key != key) {
+                return false;
+            }
+            uintptr_t succ = mcas_read(curr->next);
+            if (is_marked(succ)) {
+                continue;
+            }
+            McasDescriptor *d = new McasDescriptor;
+            d->add(pred->next, (uintptr_t)curr, succ);
+            d->add(curr->next, succ, succ | MCAS_LIST_MARK);
+            if (run(d, thread_id)) {
+                reclaimer.retire(thread_id, curr);
+                return true;
+            }
+        }
+    }
+
+    bool contains(int key, int thread_id) {
+        EpochGuard guard(reclaimer, thread_id);
+        McasNode *pred, *curr;
+        find(key, pred, curr);
+        return curr != nullptr && curr->key == key && !is_marked(mcas_read(curr->next));
+    }
+
+    // Not linearizable against concurrent updates
+    int size(int thread_id) {
+        EpochGuard guard(reclaimer, thread_id);
+        int n = 0;
+        for (McasNode *curr = node_of(mcas_read(head.next)); curr != nullptr; curr = node_of(mcas_read(curr->next))) {
+            n++;
+        }
+        return n;
+    }
+
+    // Callers guarantee no other thread is using the list
+    ~McasList() {
+        McasNode *curr = node_of(head.next.load(std::memory_order_relaxed));
+        while (curr != nullptr) {
+            McasNode *next = node_of(curr->next.load(std::memory_order_relaxed));
+            delete curr;
+            curr = next;
+        }
+    }
+};
+
+// Atomically removes key from `from` and adds it to `to`. Returns false if
+// key is not in `from` or is already in `to`.
+inline bool mcas_move(McasList& from, McasList& to, int key, int thread_id) {
+    if (&from == &to) {
+        throw std::invalid_argument("mcas_move needs two different lists");
+    }
+    EpochGuard guard(from.reclaimer, thread_id);
+    McasNode *created = new McasNode;
+    created->key = key;
+    while (true) {
+        McasNode *from_pred, *from_curr, *to_pred, *to_curr;
+        from.find(key, from_pred, from_curr);
+        if (from_curr == nullptr || from_curr->key != key) {
+            delete created;
+            return false;
+        }
+        uintptr_t succ = mcas_read(from_curr->next);
+        if (McasList::is_marked(succ)) {
+            continue;
+        }
+        to.find(key, to_pred, to_curr);
+        if (to_curr != nullptr && to_curr->key == key) {
+            if (McasList::is_marked(mcas_read(to_curr->next))) {
+                continue;
+            }
+            delete created;
+            return false;
+        }
+
+        created->next.store((uintptr_t)to_curr, std::memory_order_relaxed);
+        McasDescriptor *d = new McasDescriptor;
+        d->add(from_pred->next, (uintptr_t)from_curr, succ);
+        d->add(from_curr->next, succ, succ | MCAS_LIST_MARK);
+        d->add(to_pred->next, (uintptr_t)to_curr, (uintptr_t)created);
+        if (from.run(d, thread_id)) {
+            from.reclaimer.retire(thread_id, from_curr);
+            return true;
+        }
+    }
+}
+
+// Adds key to `into` only if neither list holds it, checked and applied atomically
+inline bool mcas_insert_if_absent_in_both(McasList& into, McasList& other, int key, int thread_id) {
+    if (&into == &other) {
+        throw std::invalid_argument("mcas_insert_if_absent_in_both needs two different lists");
+    }
+    EpochGuard guard(into.reclaimer, thread_id);
+    McasNode *created = new McasNode;
+    created->key = key;
+    while (true) {
+        McasNode *into_pred, *into_curr, *other_pred, *other_curr;
+        into.find(key, into_pred, into_curr);
+        other.find(key, other_pred, other_curr);
+        bool retry = false;
+        for (McasNode *curr : {into_curr, other_curr}) {
+            if (curr != nullptr && curr->key == key) {
+                if (!McasList::is_marked(mcas_read(curr->next))) {
+                    delete created;
+                    return false;
+                }
+                retry = true;
+            }
+        }
+        if (retry) {
+            continue;
+        }
+
+        created->next.store((uintptr_t)into_curr, std::memory_order_relaxed);
+        McasDescriptor *d = new McasDescriptor;
+        d->add(into_pred->next, (uintptr_t)into_curr, (uintptr_t)created);
+        // Unchanged, only checked: nothing was inserted where key would go in `other`
+        d->add(other_pred->next, (uintptr_t)other_curr, (uintptr_t)other_curr);
+        if (into.run(d, thread_id)) {
+            return true;
+        }
+    }
+}
+
+// Baseline for the benchmark: a lazy sorted list (lock-free reads, per-node
+// mutexes for updates). Operations spanning two lists lock the affected
+// nodes of both with std::lock, which backs off instead of deadlocking.
+struct LockedSetNode {
+    int key;
+    std::atomic<LockedSetNode *> next{nullptr};
+    std::atomic<bool> marked{false};
+    std::mutex n_lock;
+};
+
+class LockedSortedList {
+private:
+    LockedSetNode head;
+    EpochReclaimer& reclaimer;
+
+    void find(int key, LockedSetNode *&pred, LockedSetNode *&curr) {
+        pred = &head;
+        curr = head.next.load(std::memory_order_acquire);
+        while (curr != nullptr && curr->key < key) {
+            pred = curr;
+            curr = curr->next.load(std::memory_order_acquire);
+        }
+    }
+
+    // Caller holds pred's lock (and curr's, if not null)
+    static bool validate(LockedSetNode *pred, LockedSetNode *curr) {
+        return !pred->marked.load(std::memory_order_relaxed)
+            && (curr == nullptr || !curr->marked.load(std::memory_order_relaxed))
+            && pred->next.load(std::memory_order_relaxed) == curr;
+    }
+
+    friend bool locked_move(LockedSortedList& from, LockedSortedList& to, int key, int thread_id);
+    friend bool locked_insert_if_absent_in_both(LockedSortedList& into, LockedSortedList& other, int key,
+                                                int thread_id);
+
+public:
+    LockedSortedList(EpochReclaimer& r) : reclaimer(r) {
+        head.key = INT_MIN;
+    }
+
+    LockedSortedList(const LockedSortedList&) = delete;
+    LockedSortedList& operator=(const LockedSortedList&) = delete;
+
+    bool insert(int key, int thread_id) {
+        EpochGuard guard(reclaimer, thread_id);
+        while (true) {
+            LockedSetNode *pred, *curr;
+            find(key, pred, curr);
+            std::lock_guard<std::mutex> pred_guard(pred->n_lock);
+            if (pred->marked.load(std::memory_order_relaxed) || pred->next.load(std::memory_order_relaxed) != curr) {
+                continue;
+            }
+            if (curr != nullptr && curr->key == key) {
+                return false;
+            }
+            LockedSetNode *created = new LockedSetNode;
+            created->key = key;
+            created->next.store(curr, std::memory_order_relaxed);
+            pred->next.store(created, std::memory_order_release);
+            return true;
+        }
+    }
+
+    bool contains(int key, int thread_id) {
+        EpochGuard guard(reclaimer, thread_id);
+        LockedSetNode *pred, *curr;
+        find(key, pred, curr);
+        return curr != nullptr && curr->key == key && !curr->marked.load(std::memory_order_acquire);
+    }
+
+    int size(int thread_id) {
+        EpochGuard guard(reclaimer, thread_id);
+        int n = 0;
+        for (LockedSetNode *curr = head.next.load(std::memory_order_acquire); curr != nullptr;
+             curr = curr->next.load(std::memory_order_acquire)) {
+            n++;
+        }
+        return n;
+    }
+
+    ~LockedSortedList() {
+        LockedSetNode *curr = head.next.load(std::memory_order_relaxed);
+        while (curr != nullptr) {
+            LockedSetNode *next = curr->next.load(std::memory_order_relaxed);
+            delete curr;
+            curr = next;
+        }
+    }
+};
+
+inline bool locked_move(LockedSortedList& from, LockedSortedList& to, int key, int thread_id) {
+    if (&from == &to) {
+        throw std::invalid_argument("locked_move needs two different lists");
+    }
+    EpochGuard guard(from.reclaimer, thread_id);
+    while (true) {
+        LockedSetNode *from_pred, *from_curr, *to_pred, *to_curr;
+        from.find(key, from_pred, from_curr);
+        if (from_curr == nullptr || from_curr->key != key) {
+            return false;
+        }
+        to.find(key, to_pred, to_curr);
+
+        std::unique_lock<std::mutex> a(from_pred->n_lock, std::defer_lock);
+        std::unique_lock<std::mutex> b(from_curr->n_lock, std::defer_lock);
+        std::unique_lock<std::mutex> c(to_pred->n_lock, std::defer_lock);
+        std::lock(a, b, c);
+        if (!LockedSortedList::validate(from_pred, from_curr) || to_pred->marked.load(std::memory_order_relaxed)
+            || to_pred->next.load(std::memory_order_relaxed) != to_curr) {
+            continue;
+        }
+        if (to_curr != nullptr && to_curr->key == key) {
+            return false;
+        }
+
+        LockedSetNode *created = new LockedSetNode;
+        created->key = key;
+        created->next.store(to_curr, std::memory_order_relaxed);
+        from_curr->marked.store(true, std::memory_order_release);
+        from_pred->next.store(from_curr->next.load(std::memory_order_relaxed), std::memory_order_release);
+        to_pred->next.store(created, std::memory_order_release);
+        a.unlock();
+        b.unlock();
+        c.unlock();
+        from.reclaimer.retire(thread_id, from_curr);
+        return true;
+    }
+}
+
+// Holds both predecessors' locks, so neither list can gain key meanwhile
+inline bool locked_insert_if_absent_in_both(LockedSortedList& into, LockedSortedList& other, int key,
+                                            int thread_id) {
+    if (&into == &other) {
+        throw std::invalid_argument("locked_insert_if_absent_in_both needs two different lists");
+    }
+    EpochGuard guard(into.reclaimer, thread_id);
+    while (true) {
+        LockedSetNode *into_pred, *into_curr, *other_pred, *other_curr;
+        into.find(key, into_pred, into_curr);
+        other.find(key, other_pred, other_curr);
+
+        std::unique_lock<std::mutex> a(into_pred->n_lock, std::defer_lock);
+        std::unique_lock<std::mutex> b(other_pred->n_lock, std::defer_lock);
+        std::lock(a, b);
+        if (into_pred->marked.load(std::memory_order_relaxed) || other_pred->marked.load(std::memory_order_relaxed)
+            || into_pred->next.load(std::memory_order_relaxed) != into_curr
+            || other_pred->next.load(std::memory_order_relaxed) != other_curr) {
+            continue;
+        }
+        if ((into_curr != nullptr && into_curr->key == key) || (other_curr != nullptr && other_curr->key == key)) {
+            return false;
+        }
+
+        LockedSetNode *created = new LockedSetNode;
+        created->key = key;
+        created->next.store(into_curr, std::memory_order_relaxed);
+        into_pred->next.store(created, std::memory_order_release);
+        return true;
+    }
+}
+
+#endif // MCAS_LIST_H
@@ -0,0 +1,380 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "locks.h"
+
+typedef std::vector<std::pair<std::string, std::string>> MetricLabels;
+
+// Monotonic counter striped over padded slots so concurrent writers do not
+// share a line; reads sum the stripes
+class MetricCounter {
+private:
+    static const int STRIPES = 16;
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> value{0};
+    };
+    Stripe stripes[STRIPES];
+
+public:
+    void increment(uint64_t n = 1) {
+        stripes[lock_thread_index() % STRIPES].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const Stripe& s : stripes) {
+            total += s.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+};
+
+class MetricGauge {
+private:
+    std::atomic<int64_t> current{0};
+
+public:
+    void set(int64_t v) { current.store(v, std::memory_order_relaxed); }
+    void add(int64_t n) { current.fetch_add(n, std::memory_order_relaxed); }
+    int64_t value() const { return current.load(std::memory_order_relaxed); }
+};
+
+// Fixed-bucket histogram; observe() is one relaxed add and one CAS on the sum
+class MetricHistogram {
+private:
+    std::vector<double> bounds;  // Upper bounds, ascending; +Inf is implicit
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    std::atomic<double> sum{0.0};
+
+public:
+    explicit MetricHistogram(std::vector<double> upper_bounds)
+        : bounds(std::move(upper_bounds)), buckets(new std::atomic<uint64_t>[bounds.size() + 1]) {
+        for (size_t i = 0; i <= bounds.size(); i++) {
+            buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void observe(double v) {
+        size_t i = 0;
+        while (i < bounds.size() && v > bounds[i]) {
+            i++;
+        }
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+        double old_sum = sum.load(std::memory_order_relaxed);
+        while (!sum.compare_exchange_weak(old_sum, old_sum + v, std::memory_order_relaxed)) {}
+    }
+
+    const std::vector<double>& upper_bounds() const { return bounds; }
+    uint64_t bucket(size_t i) const { return buckets[i].load(std::memory_order_relaxed); }
+    double total_sum() const { return sum.load(std::memory_order_relaxed); }
+};
+
+enum MetricType { METRIC_COUNTER, METRIC_GAUGE, METRIC_HISTOGRAM };
+
+// Names metrics and exports them all in one pass. Writers only touch their
+// metric's atomics; the registry lock is taken for registration and while
+// an export copies values out, never on the update path.
+class MetricsRegistry {
+private:
+    struct Entry {
+        std::string name;
+        MetricLabels labels;
+        std::string help;
+        MetricType type;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::unique_ptr<MetricHistogram> histogram;
+        std::function<double()> callback;  // For values that live elsewhere
+    };
+
+    // Everything an export needs, copied out under the lock so formatting
+    // after it is released can't race an unregister()
+    struct Sample {
+        std::string name;
+        MetricLabels labels;
+        std::string help;
+        MetricType type;
+        bool has_buckets;
+        std::vector<double> bounds;
+        double value;
+        std::vector<uint64_t> buckets;
+        uint64_t count;
+    };
+
+    std::mutex entries_lock;
+    std::vector<std::unique_ptr<Entry>> entries;
+
+    Entry *find_or_add(const std::string& name, const MetricLabels& labels, const std::string& help,
+                       MetricType type, bool& created) {
+        for (auto& e : entries) {
+            if (e->name == name && e->labels == labels) {
+                if (e->type != type) {
+                    throw std::invalid_argument("Metric " + name + " already registered with another type");
+                }
+                created = false;
+                return e.get();
+            }
+        }
+        entries.push_back(std::unique_ptr<Entry>(new Entry{name, labels, help, type, nullptr, nullptr, nullptr, nullptr}));
+        created = true;
+        return entries.back().get();
+    }
+
+    static std::string escape(const std::string& text) {
+        std::string out;
+        for (char c : text) {
+            if (c == '\\' || c == '"') {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else {
+                out += c;
+            }
+        }
+        return out;
+    }
+
+    static std::string label_text(const MetricLabels& labels, const std::string& extra = "") {
+        if (labels.empty() && extra.empty()) {
+            return "";
+        }
+        std::string out = "{";
+        for (size_t i = 0; i < labels.size(); i++) {
+            out += (i ? "," : "") + labels[i].first + "=\"" + escape(labels[i].second) + "\"";
+        }
+        if (!extra.empty()) {
+            out += (labels.empty() ? "" : ",") + extra;
+        }
+        return out + "}";
+    }
+
+    std::vector<Sample> snapshot() {
+        std::lock_guard<std::mutex> guard(entries_lock);
+        std::vector<Sample> samples;
+        samples.reserve(entries.size());
+        for (auto& e : entries) {
+            Sample s{e->name, e->labels, e->help, e->type, false, {}, 0.0, {}, 0};
+            if (e->callback) {
+                s.value = e->callback();
+            } else if (e->type == METRIC_COUNTER) {
+                s.value = (double)e->counter->value();
+            } else if (e->type == METRIC_GAUGE) {
+                s.value = (double)e->gauge->value();
+            } else {
+                s.has_buckets = true;
+                s.bounds = e->histogram->upper_bounds();
+                for (size_t i = 0; i <= s.bounds.size(); i++) {
+                    s.buckets.push_back(e->histogram->bucket(i));
+                    s.count += s.buckets.back();
+                }
+                // _count is the +Inf bucket, so it agrees with the buckets even
+                // when observe() runs during the copy
+                s.value = e->histogram->total_sum();
+            }
+            samples.push_back(std::move(s));
+        }
+        return samples;
+    }
+
+    static const char *type_name(MetricType type) {
+        return type == METRIC_COUNTER ? "counter" : type == METRIC_GAUGE ? "gauge" : "histogram";
+    }
+
+public:
+    MetricCounter& counter(const std::string& name, const MetricLabels& labels = {}, const std::string& help = "") {
+        std::lock_guard<std::mutex> guard(entries_lock);
+        bool created;
+        Entry *e = find_or_add(name, labels, help, METRIC_COUNTER, created);
+        if (created) e->counter.reset(new MetricCounter);
+        return *e->counter;
+    }
+
+    MetricGauge& gauge(const std::string& name, const MetricLabels& labels = {}, const std::string& help = "") {
+        std::lock_guard<std::mutex> guard(entries_lock);
+        bool created;
+        Entry *e = find_or_add(name, labels, help, METRIC_GAUGE, created);
+        if (created) e->gauge.reset(new MetricGauge);
+        return *e->gauge;
+    }
+
+    MetricHistogram& histogram(const std::string& name, std::vector<double> upper_bounds,
+                               const MetricLabels& labels = {}, const std::string& help = "") {
+        std::lock_guard<std::mutex> guard(entries_lock);
+        bool created;
+        Entry *e = find_or_add(name, labels, help, METRIC_HISTOGRAM, created);
+        if (created) e->histogram.reset(new MetricHistogram(std::move(upper_bounds)));
+        return *e->histogram;
+    }
+
+    // Exposes a value owned elsewhere, e.g. an ApproximateConcurrentCounter;
+    // the callback runs during export and must stay valid until unregistered.
+    // A callback yields one value, so it can be a counter or gauge only.
+    void register_callback(const std::string& name, MetricType type, std::function<double()> read,
+                           const MetricLabels& labels = {}, const std::string& help = "") {
+        if (type == METRIC_HISTOGRAM) {
+            throw std::invalid_argument("Callback metric " + name + " cannot be a histogram");
+        }
+        std::lock_guard<std::mutex> guard(entries_lock);
+        bool created;
+        Entry *e = find_or_add(name, labels, help, type, created);
+        e->callback = std::move(read);
+    }
+
+    void unregister(const std::string& name, const MetricLabels& labels = {}) {
+        std::lock_guard<std::mutex> guard(entries_lock);
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i]->name == name && entries[i]->labels == labels) {
+                entries.erase(entries.begin() + i);
+                return;
+            }
+        }
+    }
+
+    // Prometheus text exposition format
+    std::string to_prometheus() {
+        std::vector<Sample> samples = snapshot();
+        // Series of one metric family must be adjacent
+        std::stable_sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) {
+            return a.name < b.name;
+        });
+        std::ostringstream out;
+        out.precision(15);  // Whole counts print without an exponent
+        std::string last_name;
+        for (const Sample& s : samples) {
+            if (s.name != last_name) {
+                if (!s.help.empty()) {
+                    out << "# HELP " << s.name << " " << s.help << "\n";
+                }
+                out << "# TYPE " << s.name << " " << type_name(s.type) << "\n";
+                last_name = s.name;
+            }
+            if (!s.has_buckets) {
+                out << s.name << label_text(s.labels) << " " << s.value << "\n";
+                continue;
+            }
+            const std::vector<double>& bounds = s.bounds;
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i <= bounds.size(); i++) {
+                cumulative += s.buckets[i];
+                std::ostringstream le;
+                if (i < bounds.size()) {
+                    le << "le=\"" << bounds[i] << "\"";
+                } else {
+                    le << "le=\"+Inf\"";
+                }
+                out << s.name << "_bucket" << label_text(s.labels, le.str()) << " " << cumulative << "\n";
+            }
+            out << s.name << "_sum" << label_text(s.labels) << " " << s.value << "\n";
+            out << s.name << "_count" << label_text(s.labels) << " " << s.count << "\n";
+        }
+        return out.str();
+    }
+
+    std::string to_json() {
+        std::vector<Sample> samples = snapshot();
+        std::ostringstream out;
+        out.precision(15);  // Whole counts print without an exponent
+        out << "[";
+        for (size_t n = 0; n < samples.size(); n++) {
+            const Sample& s = samples[n];
+            out << (n ? "," : "") << "\n  {\"name\":\"" << escape(s.name) << "\",\"type\":\""
+                << type_name(s.type) << "\",\"labels\":{";
+            for (size_t i = 0; i < s.labels.size(); i++) {
+                out << (i ? "," : "") << "\"" << escape(s.labels[i].first) << "\":\""
+                    << escape(s.labels[i].second) << "\"";
+            }
+            out << "}";
+            if (s.has_buckets) {
+                out << ",\"buckets\":[";
+                // Cumulative, like the Prometheus _bucket series
+                const std::vector<double>& bounds = s.bounds;
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i <= bounds.size(); i++) {
+                    cumulative += s.buckets[i];
+                    out << (i ? "," : "") << "{\"le\":";
+                    if (i < bounds.size()) {
+                        out << bounds[i];
+                    } else {
+                        out << "\"+Inf\"";
+                    }
+                    out << ",\"count\":" << cumulative << "}";
+                }
+                out << "],\"sum\":" << s.value << ",\"count\":" << s.count << "}";
+            } else {
+                out << ",\"value\":" << s.value << "}";
+            }
+        }
+        out << "\n]\n";
+        return out.str();
+    }
+
+    // Writes to a temporary file and renames it, so scrapers never see a partial file
+    static int write_file(const std::string& path, const std::string& text) {
+        std::string tmp = path + ".tmp";
+        std::FILE *out = std::fopen(tmp.c_str(), "wb");
+        if (out == nullptr) {
+            return -1;
+        }
+        bool ok = std::fwrite(text.data(), 1, text.size(), out) == text.size();
+        ok = (std::fclose(out) == 0) && ok;
+        if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::remove(tmp.c_str());
+            return -1;
+        }
+        return 0;
+    }
+
+    // Sends the text to a local collector listening on a Unix stream socket
+    static int write_socket(const std::string& socket_path, const std::string& text) {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(addr.sun_path)) {
+            return -1;
+        }
+        std::strcpy(addr.sun_path, socket_path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+        size_t sent = 0;
+        while (sent < text.size()) {
+            ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                close(fd);
+                return -1;
+            }
+            sent += n;
+        }
+        close(fd);
+        return 0;
+    }
+};
+
+inline MetricsRegistry& metrics_registry() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+#endif // METRICS_H
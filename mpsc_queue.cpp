@@ -0,0 +1,100 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include "mpsc_queue.h"
+#include "hand_lock_ll.h"
+
+// Actor mailbox throughput: several producers post messages, one consumer
+// drains them. The intrusive queue is compared with List used as a mailbox.
+
+struct Message : MpscNode {
+    int key;
+};
+
+long long time_mpsc(int producers, int messages, long long& checksum) {
+    MpscQueue<Message> mailbox;
+    long long total = (long long)producers * messages;
+    checksum = 0;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::thread consumer([&] {
+        for (long long received = 0; received < total;) {
+            Message *msg = mailbox.pop();
+            if (msg == nullptr) {
+                std::this_thread::yield();
+                continue;
+            }
+            checksum += msg->key;
+            delete msg;
+            received++;
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&mailbox, messages] {
+            for (int i = 0; i < messages; i++) {
+                Message *msg = new Message;
+                msg->key = i;
+                mailbox.push(msg);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    consumer.join();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+}
+
+long long time_list(int producers, int messages, long long& checksum) {
+    List mailbox{};
+    long long total = (long long)producers * messages;
+    checksum = 0;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::thread consumer([&] {
+        for (long long received = 0; received < total;) {
+            int key;
+            if (!mailbox.pop_front(key)) {
+                std::this_thread::yield();
+                continue;
+            }
+            checksum += key;
+            received++;
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&mailbox, messages] {
+            for (int i = 0; i < messages; i++) {
+                mailbox.insert(i);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    consumer.join();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+}
+
+int main(int argc, char **argv) {
+    int messages = argc > 1 ? std::stoi(argv[1]) : 500000;
+    long long expected_per_producer = (long long)messages * (messages - 1) / 2;
+
+    std::cout << "=== Mailbox throughput (" << messages << " messages per producer, 1 consumer) ===" << std::endl;
+    for (int producers = 1; producers <= 8; producers *= 2) {
+        long long mpsc_sum, list_sum;
+        long long mpsc_ms = time_mpsc(producers, messages, mpsc_sum);
+        long long list_ms = time_list(producers, messages, list_sum);
+        long long expected = expected_per_producer * producers;
+        std::cout << producers << " producer(s): MpscQueue " << mpsc_ms << " ms, List " << list_ms << " ms"
+                  << ((mpsc_sum == expected && list_sum == expected) ? "" : " (CHECKSUM MISMATCH)") << std::endl;
+    }
+    return 0;
+}
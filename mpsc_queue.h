@@ -0,0 +1,75 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+
+// Link embedded in every queued object, like node_t's next pointer:
+//     struct Message : MpscNode { int key; };
+struct MpscNode {
+    std::atomic<MpscNode *> next{nullptr};
+};
+
+// Dmitry Vyukov's intrusive multi-producer single-consumer queue. A push is
+// one exchange plus one store, with no CAS loop, so producers never retry.
+// Only one thread may pop. The queue never allocates or frees: nodes belong
+// to the producer until pushed and to the consumer once popped.
+template <typename T>
+class MpscQueue {
+private:
+    alignas(64) std::atomic<MpscNode *> head;  // Last pushed, swapped by producers
+    alignas(64) MpscNode *tail;                // Next to pop, consumer only
+    MpscNode stub;
+
+    void push_node(MpscNode *node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        MpscNode *prev = head.exchange(node, std::memory_order_acq_rel);
+        // Between the exchange and this store the chain is briefly broken;
+        // pop() sees that as empty until the link lands
+        prev->next.store(node, std::memory_order_release);
+    }
+
+public:
+    MpscQueue() : head(&stub), tail(&stub) {}
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T *item) {
+        push_node(item);
+    }
+
+    // Returns nullptr if empty or if a producer is halfway through a push
+    T *pop() {
+        MpscNode *first = tail;
+        MpscNode *next = first->next.load(std::memory_order_acquire);
+        if (first == &stub) {
+            if (next == nullptr) {
+                return nullptr;
+            }
+            tail = next;
+            first = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != nullptr) {
+            tail = next;
+            return static_cast<T *>(first);
+        }
+        if (first != head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        // first is the only node left: queue the stub behind it so it can go
+        push_node(&stub);
+        next = first->next.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            tail = next;
+            return static_cast<T *>(first);
+        }
+        return nullptr;
+    }
+
+    // Consumer-side check; may report empty while a push is in flight
+    bool empty() const {
+        return tail == &stub && stub.next.load(std::memory_order_acquire) == nullptr;
+    }
+};
+
+#endif // MPSC_QUEUE_H
@@ -0,0 +1,282 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "concurrent_ds.h"
+#include "hand_lock_ll.h"
+
+// Trace file layout: TraceHeader, then one TraceStream per recorded thread,
+// then each thread's records back to back. Keeping a thread's records
+// contiguous lets every replay thread stream its own section independently.
+struct TraceHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t num_threads;
+    uint32_t reserved;
+};
+
+struct TraceStream {
+    uint64_t offset;  // Byte offset of the first record
+    uint64_t count;
+};
+
+enum TraceOp : uint8_t {
+    OP_LIST_INSERT = 0,
+    OP_LIST_CLEAR,
+    OP_COUNTER_INCREMENT,
+    OP_COUNTER_READ,
+    OP_SHARED_INCREMENT,
+    OP_SHARED_READ,
+    OP_COUNT
+};
+
+struct TraceRecord {
+    uint64_t timestamp_ns;  // Relative to the start of the recording
+    int32_t key;
+    uint16_t thread;
+    uint8_t op;
+    uint8_t pad;
+};
+
+static const char TRACE_MAGIC[4] = {'T', 'R', 'C', 'E'};
+static const uint32_t TRACE_VERSION = 1;
+
+// Pages behind the cursor are dropped once this many bytes have been replayed,
+// so resident memory stays bounded no matter how large the trace is
+static const size_t STREAM_WINDOW = 64 << 20;
+
+// Everything a trace can touch
+struct ReplayTargets {
+    List list;
+    ApproximateConcurrentCounter counter;
+    SharedCounter shared_counter;
+    std::atomic<long long> read_sink{0};
+
+    explicit ReplayTargets(int threads) : counter(threads) {}
+};
+
+struct ReplayResult {
+    uint64_t ops{0};
+    uint64_t first_ts{UINT64_MAX};
+    uint64_t last_ts{0};
+};
+
+void replay_thread(ReplayTargets& targets, const char *base, TraceStream stream, int thread_id,
+                   bool paced, std::chrono::steady_clock::time_point epoch, ReplayResult& result) {
+    const TraceRecord *records = reinterpret_cast<const TraceRecord *>(base + stream.offset);
+    const long page = sysconf(_SC_PAGESIZE);
+    uintptr_t released = (uintptr_t)records & ~(uintptr_t)(page - 1);
+    long long reads = 0;
+
+    for (uint64_t i = 0; i < stream.count; i++) {
+        const TraceRecord& rec = records[i];
+
+        if (paced) {
+            auto due = epoch + std::chrono::nanoseconds(rec.timestamp_ns);
+            while (std::chrono::steady_clock::now() < due) {
+                std::this_thread::yield();
+            }
+        }
+
+        switch (rec.op) {
+        case OP_LIST_INSERT:
+            targets.list.insert(rec.key);
+            break;
+        case OP_LIST_CLEAR:
+            targets.list.clear();
+            break;
+        case OP_COUNTER_INCREMENT:
+            targets.counter.increment(thread_id);
+            break;
+        case OP_COUNTER_READ:
+            reads += targets.counter.get_approximate_count();
+            break;
+        case OP_SHARED_INCREMENT:
+            targets.shared_counter.increment();
+            break;
+        case OP_SHARED_READ:
+            reads += targets.shared_counter.get_count();
+            break;
+        }
+
+        if (rec.timestamp_ns < result.first_ts) result.first_ts = rec.timestamp_ns;
+        if (rec.timestamp_ns > result.last_ts) result.last_ts = rec.timestamp_ns;
+
+        uintptr_t cursor = (uintptr_t)&records[i];
+        if (cursor - released >= STREAM_WINDOW) {
+            uintptr_t upto = cursor & ~(uintptr_t)(page - 1);
+            madvise((void *)released, upto - released, MADV_DONTNEED);
+            released = upto;
+        }
+    }
+
+    result.ops = stream.count;
+    targets.read_sink.fetch_add(reads, std::memory_order_relaxed);
+}
+
+int replay(const char *path, bool paced) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Cannot open trace " << path << std::endl;
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceHeader)) {
+        std::cout << "Trace too short: " << path << std::endl;
+        close(fd);
+        return 1;
+    }
+    const char *base = static_cast<const char *>(mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+    if (base == MAP_FAILED) {
+        std::cout << "mmap failed for " << path << std::endl;
+        return 1;
+    }
+    madvise((void *)base, st.st_size, MADV_SEQUENTIAL);
+
+    const TraceHeader *header = reinterpret_cast<const TraceHeader *>(base);
+    const TraceStream *streams = reinterpret_cast<const TraceStream *>(header + 1);
+    if (std::memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0
+        || header->version != TRACE_VERSION || header->num_threads == 0
+        || sizeof(TraceHeader) + header->num_threads * sizeof(TraceStream) > (size_t)st.st_size) {
+        std::cout << "Not a trace file: " << path << std::endl;
+        munmap((void *)base, st.st_size);
+        return 1;
+    }
+    int num_threads = header->num_threads;
+    uint64_t size = st.st_size;
+    for (int i = 0; i < num_threads; i++) {
+        // Written so a corrupt header can't overflow its way past the check
+        uint64_t offset = streams[i].offset;
+        if (offset > size || streams[i].count > (size - offset) / sizeof(TraceRecord)
+            || offset % alignof(TraceRecord) != 0) {
+            std::cout << "Stream " << i << " is misaligned or runs past end of file" << std::endl;
+            munmap((void *)base, st.st_size);
+            return 1;
+        }
+    }
+
+    std::cout << "=== Trace replay (" << num_threads << " threads"
+              << (paced ? ", paced" : ", as fast as possible") << ") ===" << std::endl;
+
+    ReplayTargets targets(num_threads);
+    std::vector<ReplayResult> results(num_threads);
+    std::vector<std::thread> threads;
+
+    auto overall_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(replay_thread, std::ref(targets), base, streams[i], i,
+                             paced, overall_start, std::ref(results[i]));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto overall_end = std::chrono::steady_clock::now();
+    munmap((void *)base, st.st_size);
+
+    uint64_t total_ops = 0, first_ts = UINT64_MAX, last_ts = 0;
+    for (const ReplayResult& r : results) {
+        total_ops += r.ops;
+        if (r.ops == 0) continue;
+        if (r.first_ts < first_ts) first_ts = r.first_ts;
+        if (r.last_ts > last_ts) last_ts = r.last_ts;
+    }
+    double wall_s = std::chrono::duration<double>(overall_end - overall_start).count();
+    double recorded_s = total_ops ? (last_ts - first_ts) / 1e9 : 0.0;
+
+    std::cout << "Replayed " << total_ops << " ops in " << wall_s * 1000 << " ms" << std::endl;
+    std::cout << "Recorded rate: " << (recorded_s > 0 ? total_ops / recorded_s : 0) << " ops/s" << std::endl;
+    std::cout << "Achieved rate: " << (wall_s > 0 ? total_ops / wall_s : 0) << " ops/s" << std::endl;
+    std::cout << "Counter: " << targets.counter.get_approximate_count()
+              << ", shared counter: " << targets.shared_counter.get_count() << std::endl;
+    return 0;
+}
+
+// Writes a synthetic trace so the driver can be exercised without a production capture
+int generate(const char *path, int num_threads, uint64_t ops_per_thread) {
+    std::FILE *out = std::fopen(path, "wb");
+    if (out == nullptr) {
+        std::cout << "Cannot create " << path << std::endl;
+        return 1;
+    }
+
+    TraceHeader header;
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.num_threads = num_threads;
+    header.reserved = 0;
+
+    std::vector<TraceStream> streams(num_threads);
+    uint64_t offset = sizeof(TraceHeader) + num_threads * sizeof(TraceStream);
+    for (int t = 0; t < num_threads; t++) {
+        streams[t].offset = offset;
+        streams[t].count = ops_per_thread;
+        offset += ops_per_thread * sizeof(TraceRecord);
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1
+              && std::fwrite(streams.data(), sizeof(TraceStream), num_threads, out) == (size_t)num_threads;
+
+    // Mostly counter traffic with a steady trickle of inserts, roughly 10M ops/s per thread
+    std::vector<TraceRecord> buffer;
+    buffer.reserve(1 << 16);
+    for (int t = 0; ok && t < num_threads; t++) {
+        std::mt19937 rng(t + 1);
+        uint64_t ts = 0;
+        for (uint64_t i = 0; ok && i < ops_per_thread; i++) {
+            TraceRecord rec;
+            unsigned roll = rng() % 100;
+            rec.op = roll < 50 ? OP_COUNTER_INCREMENT
+                   : roll < 70 ? OP_SHARED_INCREMENT
+                   : roll < 80 ? OP_COUNTER_READ
+                   : roll < 85 ? OP_SHARED_READ
+                   : OP_LIST_INSERT;
+            rec.key = (int32_t)(rng() & 0x7fffffff);
+            rec.thread = (uint16_t)t;
+            rec.pad = 0;
+            ts += 50 + rng() % 100;
+            rec.timestamp_ns = ts;
+            buffer.push_back(rec);
+            if (buffer.size() == buffer.capacity()) {
+                ok = std::fwrite(buffer.data(), sizeof(TraceRecord), buffer.size(), out) == buffer.size();
+                buffer.clear();
+            }
+        }
+        if (ok && !buffer.empty()) {
+            ok = std::fwrite(buffer.data(), sizeof(TraceRecord), buffer.size(), out) == buffer.size();
+            buffer.clear();
+        }
+    }
+    ok = (std::fclose(out) == 0) && ok;
+    if (!ok) {
+        std::cout << "Failed writing " << path << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << num_threads << " x " << ops_per_thread << " ops to " << path << std::endl;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 3 && std::string(argv[1]) == "gen") {
+        int num_threads = argc > 3 ? std::stoi(argv[3]) : 4;
+        uint64_t ops = argc > 4 ? std::stoull(argv[4]) : 1000000;
+        return generate(argv[2], num_threads, ops);
+    }
+    if (argc >= 2) {
+        bool paced = argc > 2 && std::string(argv[2]) == "--paced";
+        return replay(argv[1], paced);
+    }
+
+    std::cout << "usage: " << argv[0] << " gen <trace> [threads] [ops_per_thread]" << std::endl;
+    std::cout << "       " << argv[0] << " <trace> [--paced]" << std::endl;
+    return 1;
+}